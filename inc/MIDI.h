@@ -31,8 +31,17 @@
 #define __MIDI_h__
 
 #include <stdbool.h>
+#include <stdint.h>
 
 bool MIDIInit(const uint8_t* data);
 bool MIDIUpdate(uint16_t tick_us, bool repeat, uint16_t gap);
 
+// Returns how many times MIDIUpdate() has rewound the track to repeat.
+uint32_t MIDIGetLoops();
+
+// Serializes sequencer state, i.e. track cursor, tempo, and pending tick.
+uint32_t MIDIStateSize();
+void MIDISave(uint8_t* state);
+void MIDILoad(const uint8_t* state);
+
 #endif // __MIDI_h__
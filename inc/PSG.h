@@ -38,4 +38,40 @@ bool PSGWrite(uint8_t reg, uint8_t value);
 bool PSGRead(uint8_t reg, uint8_t* value);
 int16_t PSGUpdate();
 
+// Applies register writes made since the last call to the parameters that
+// PSGUpdate() uses. Returns true if anything was applied.
+bool PSGFlush();
+
+// Returns true if register writes are waiting for PSGFlush().
+bool PSGIsDirty();
+
+// Returns true if a write to |reg| takes effect at the next PSGFlush(), and
+// false if it takes effect at once or is ignored.
+bool PSGIsDeferred(uint8_t reg);
+
+// Advances the synthesizer state as PSGUpdate() does for |samples| samples,
+// without rendering them. The result is exact.
+void PSGSkip(uint32_t samples);
+
+// Restarts tone and noise generators from their initial phases.
+void PSGResetPhase();
+
+#if defined(BUILD_METER)
+#  include "Meter.h"
+
+// Samples the current level of each voice for meters. PSGLatchMeters() turns
+// samples since the last call into 3 levels, and starts the next window.
+void PSGMeter();
+void PSGLatchMeters(MeterLevel* levels);
+#endif
+
+// Returns the current input clock in Hz that the virtual clock selects.
+uint32_t PSGGetClock();
+
+// Serializes whole emulator state into a |state| buffer of PSGStateSize()
+// bytes, or restores it from one.
+uint32_t PSGStateSize();
+void PSGSave(uint8_t* state);
+void PSGLoad(const uint8_t* state);
+
 #endif // __PSG_h__
@@ -0,0 +1,71 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef __RenderAhead_h__
+#define __RenderAhead_h__
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Renders ahead of the playback cursor to absorb host jitter. Register writes
+// carry the sample position they should take effect at. A write that falls
+// into already rendered samples restores the snapshot at or before it, and
+// the rest is rendered again with the write applied. Positions count samples
+// from RenderAheadInit(). All functions should be called from one thread.
+
+// Starts from the current state. |buffer| keeps up to |capacity| rendered
+// samples, and |snapshots| keeps |count| x SoundCortexStateSize() bytes of
+// snapshots taken every |interval| samples. |count| should be at least 2,
+// and rendering stops ahead at |count| - 1 intervals from the cursor.
+void RenderAheadInit(uint16_t* buffer, uint32_t capacity,
+                     uint8_t* snapshots, uint32_t count, uint32_t interval);
+
+// Renders ahead as far as buffers allow. Returns rendered samples.
+uint32_t RenderAheadFill();
+
+// Takes up to |samples| samples at the playback cursor into |output|, and
+// returns how many were ready.
+uint32_t RenderAheadRead(uint16_t* output, uint32_t samples);
+
+// Schedules a write to |reg| of |chip|, i.e. PSG_ADDRESS or SCC_ADDRESS, at
+// sample |time|. A write older than the cursor takes effect at the cursor.
+// Returns false if RENDER_AHEAD_LOG writes are already pending.
+bool RenderAheadWrite(uint32_t time, uint8_t chip, uint8_t reg, uint8_t value);
+
+typedef struct {
+  uint32_t writes;      // accepted writes
+  uint32_t rollbacks;   // writes into rendered samples
+  uint32_t rerendered;  // unplayed samples thrown away by rollbacks
+  uint32_t late;        // writes older than the cursor
+  uint32_t dropped;     // writes rejected for a full log
+} RenderAheadStats;
+
+void RenderAheadGetStats(RenderAheadStats* stats);
+
+#endif // __RenderAhead_h__
@@ -38,4 +38,49 @@ bool SCCWrite(uint8_t reg, uint8_t value);
 bool SCCRead(uint8_t reg, uint8_t* value);
 int16_t SCCUpdate();
 
+// Applies register writes made since the last call to the parameters that
+// SCCUpdate() uses. Returns true if anything was applied.
+bool SCCFlush();
+
+// Returns true if register writes are waiting for SCCFlush().
+bool SCCIsDirty();
+
+// Returns true if a write to |reg| takes effect at the next SCCFlush(), and
+// false if it takes effect at once or is ignored.
+bool SCCIsDeferred(uint8_t reg);
+
+// Advances the synthesizer state as SCCUpdate() does for |samples| samples,
+// without rendering them. The result is exact.
+void SCCSkip(uint32_t samples);
+
+// Restarts tone generators from their initial phases.
+void SCCResetPhase();
+
+#if defined(BUILD_METER)
+#  include "Meter.h"
+
+// Samples the current level of each voice for meters. SCCLatchMeters() turns
+// samples since the last call into 5 levels, and starts the next window.
+void SCCMeter();
+void SCCLatchMeters(MeterLevel* levels);
+#endif
+
+#if defined(BUILD_SCC_INTERN)
+// Releases wave tables that voices refer to, e.g. before the thread running
+// this instance exits. SCCInit() should be called again to reuse it.
+void SCCRelease();
+
+// Returns how many wave tables did not get a slot since SCCInit(). It only
+// happens on hosts that run out of memory, or of 65535 slots, i.e. about 13000
+// instances. On a miss, a wave write is dropped and SCCWrite() returns false,
+// or SCCLoad() restores the silent table instead.
+uint32_t SCCGetWaveMisses();
+#endif
+
+// Serializes whole emulator state into a |state| buffer of SCCStateSize()
+// bytes, or restores it from one.
+uint32_t SCCStateSize();
+void SCCSave(uint8_t* state);
+void SCCLoad(const uint8_t* state);
+
 #endif // __SCC_h__
@@ -52,12 +52,134 @@
 #  include "IOEXTSlave.h"
 #endif
 
+#if defined(BUILD_TRACE)
+#  include "Trace.h"
+#endif
+
+#if defined(BUILD_RENDER_AHEAD)
+#  include "RenderAhead.h"
+#endif
+
+// SMF.h defines the song SMF[] that SoundCortexInit() starts. Host builds
+// may omit it and pass songs to MIDIInit() themselves.
 #if defined(BUILD_MIDI)
 #  include "MIDI.h"
-#  include "SMF.h"
+#  if !defined(BUILD_HOST)
+#    define SOUNDCORTEX_SMF
+#  elif defined(__has_include)
+#    if __has_include("SMF.h")
+#      define SOUNDCORTEX_SMF
+#    endif
+#  endif
+#  if defined(SOUNDCORTEX_SMF)
+#    include "SMF.h"
+#  endif
 #endif
 
 void SoundCortexInit(uint32_t sample_rate);
 uint16_t SoundCortexUpdate();
 
+// Renders |samples| samples at once. MIDI playback splits the block where it
+// changes registers, so that the output matches SoundCortexUpdate(). Bus
+// writes arriving while the block is rendered take effect in the next block.
+void SoundCortexUpdateBlock(uint16_t* buffer, uint32_t samples);
+
+#if defined(BUILD_ADAPTIVE_BLOCK)
+// Decides how many samples the next SoundCortexUpdateBlock() should render,
+// for an output buffer of |capacity| samples that still has |fill| samples
+// to play. Call it until it returns 0. Blocks shrink down to BLOCK_MIN while
+// bus writes arrive, and grow up to BLOCK_MAX after BLOCK_QUIET calls without
+// them, or at once when less than one block is left to play without writes.
+// BLOCK_QUIET counts calls, not time, so the quiet period in samples depends
+// on how often the render loop calls it and on the current block size. The
+// buffer is filled up to BLOCK_AHEAD blocks so that small blocks also mean
+// low latency.
+uint32_t SoundCortexNextBlockSize(uint32_t fill, uint32_t capacity);
+
+// Counters of what SoundCortexNextBlockSize() has seen and decided.
+typedef struct {
+  uint32_t writes;   // bus writes
+  uint32_t shrinks;  // halved as writes arrived
+  uint32_t grows;    // doubled as writes stopped
+  uint32_t starves;  // doubled as the output buffer ran low
+  uint32_t clamps;   // cut to fit BLOCK_AHEAD blocks in the buffer
+} SoundCortexBlockStats;
+
+void SoundCortexGetBlockStats(SoundCortexBlockStats* stats);
+#endif
+
+// Serializes all built-in emulator states into one SoundCortexStateSize()
+// bytes snapshot, or restores them from it.
+uint32_t SoundCortexStateSize();
+void SoundCortexSave(uint8_t* state);
+void SoundCortexLoad(const uint8_t* state);
+
+#if defined(BUILD_METER)
+// Levels of each voice and the final mix. Mix levels are of raw output values
+// including the bias, and |mix.clips| counts samples beyond METER_CLIP.
+typedef struct {
+#  if defined(BUILD_PSG)
+  MeterLevel psg[3];
+#  endif
+#  if defined(BUILD_SCC)
+  MeterLevel scc[5];
+#  endif
+  MeterLevel mix;
+} SoundCortexMeters;
+
+// Where an instance publishes levels at the end of each window. Readers on
+// any thread can copy it with SoundCortexGetMeters().
+typedef struct {
+  volatile uint32_t sequence;
+  SoundCortexMeters meters;
+} SoundCortexMeterBoard;
+
+// Makes the instance on the calling thread publish to |board|, or to the
+// default board if |board| is NULL. Each thread of BUILD_HOST has its own
+// default board, so other threads can only read levels from a board set
+// here. Instances on different threads should not share a board.
+void SoundCortexSetMeterBoard(SoundCortexMeterBoard* board);
+
+// Copies the levels last published to |board|, or to the default board of
+// the calling thread if |board| is NULL, without stopping the renderer. Should not be called from
+// interrupts that may preempt it.
+void SoundCortexGetMeters(const SoundCortexMeterBoard* board,
+                          SoundCortexMeters* meters);
+#endif
+
+#if defined(BUILD_LOOP_CACHE)
+// Lends |size| bytes of |buffer| to cache one pass of a looping song. When a
+// pass starts from the same state as the recorded one, SoundCortexUpdate()
+// streams recorded samples instead of rendering them, until a bus write
+// arrives. Tone phases restart at loop points while the cache is enabled so
+// that passes can match. |buffer| should be 2-byte aligned, and needs about
+// 2 x SoundCortexStateSize() bytes plus 2 bytes per sample of the loop.
+void SoundCortexLoopCacheInit(uint8_t* buffer, uint32_t size);
+#endif
+
+#if defined(BUILD_KEYFRAME) || defined(BUILD_RENDER_AHEAD)
+// Runs |samples| samples as SoundCortexUpdate() does without rendering audio.
+void SoundCortexAdvance(uint32_t samples);
+#endif
+
+#if defined(BUILD_RENDER_AHEAD)
+// Writes |value| to |reg| of the chip at bus address |chip| as a bus write
+// does, so that the loop cache stops streaming a pass it no longer matches.
+bool SoundCortexWrite(uint8_t chip, uint8_t reg, uint8_t value);
+#endif
+
+#if defined(BUILD_KEYFRAME)
+// Runs |count| x |interval| samples from the current state without rendering
+// audio, and stores a snapshot into |keyframes| every |interval| samples.
+// |keyframes| should have |count| x SoundCortexStateSize() bytes.
+void SoundCortexIndex(
+    uint8_t* keyframes, uint32_t count, uint32_t interval);
+
+// Restores the nearest keyframe at or before |position| samples, and runs
+// forward up to |position|. Returns false if |position| is out of the index,
+// or the index is empty.
+bool SoundCortexSeek(const uint8_t* keyframes, uint32_t count,
+                     uint32_t interval, uint32_t position);
+#endif
+
 #endif // __SoundCortex_h__
@@ -0,0 +1,55 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef __Trace_h__
+#define __Trace_h__
+
+#include <stdint.h>
+
+// Events recorded for each register write on its way to the DAC.
+enum {
+  TRACE_BUS_WRITE,  // A bus callback received a register write.
+  TRACE_APPLY,      // PSGFlush() or SCCFlush() applied pending writes.
+  TRACE_RENDER,     // The first sample reflecting applied writes is rendered.
+};
+
+// Platform provided free running clock in microseconds.
+uint32_t TraceClock();
+
+// Records an event with a timestamp into a ring buffer of TRACE_SIZE entries.
+// The oldest entry is overwritten when the ring is full. |chip| is the bus
+// address of the chip, i.e. PSG_ADDRESS or SCC_ADDRESS.
+void TraceRecord(uint8_t event, uint8_t chip, uint8_t reg, uint8_t value);
+
+// Writes recorded events as Chrome trace event format JSON, that Perfetto can
+// also load, through |output| piece by piece, and empties the ring. Each
+// write to render interval is emitted as a "latency" duration event.
+void TraceDump(void (*output)(const char* text));
+
+#endif // __Trace_h__
@@ -0,0 +1,68 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef __Counter_h__
+#define __Counter_h__
+
+#include <stdint.h>
+
+// Advances a tone or noise counter by |samples| as the assembly kernels do,
+// i.e. every sample adds |step| to |*count|, and when the sum is not larger
+// than |limit|, subtracts |limit| from it and makes a transition. Returns the
+// number of transitions. Samples between transitions are skipped at once.
+static inline uint32_t CounterSkip(
+    uint32_t* count, uint32_t limit, uint32_t step, uint32_t samples) {
+  uint32_t c = *count;
+  uint32_t transitions = 0;
+  while (samples) {
+    uint64_t next = (uint64_t)c + step;
+    if (next > limit) {
+      // Values never go below |limit| until the sum wraps around.
+      uint64_t k = (((uint64_t)1 << 32) - c + step - 1) / step;
+      if (k > samples) {
+        c += samples * step;
+        break;
+      }
+      samples -= k;
+      next = (uint64_t)c + k * step - ((uint64_t)1 << 32);
+    } else {
+      samples--;
+    }
+    if (next <= limit) {
+      c = (uint32_t)next - limit;
+      transitions++;
+    } else {
+      c = (uint32_t)next;
+    }
+  }
+  *count = c;
+  return transitions;
+}
+
+#endif  // __Counter_h__
@@ -0,0 +1,50 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef __Host_h__
+#define __Host_h__
+
+// BUILD_HOST builds emulators for hosts, e.g. tools that render songs
+// offline. C kernels replace the assembly ones, and mutable globals are kept
+// per thread so that threads can render independent segments at once.
+#if defined(BUILD_HOST)
+#  define HOST_LOCAL _Thread_local
+#  if defined(BUILD_FUSED)
+#    error "BUILD_FUSED has only a Cortex-M0 kernel"
+#  endif
+#else
+#  define HOST_LOCAL
+#endif
+
+// The fused kernel renders both chips at once, and has no single chip form.
+#if defined(BUILD_FUSED) && !(defined(BUILD_PSG) && defined(BUILD_SCC))
+#  error "BUILD_FUSED needs both BUILD_PSG and BUILD_SCC"
+#endif
+
+#endif  // __Host_h__
@@ -30,26 +30,57 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <string.h>
 
+#include "BuildConfig.h"
+#include "Host.h"
 #include "PSG.h"
 
-static uint16_t note_param[128] = {
-  0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff, 0xfff,
+// Tone periods are generated for the PSG clock in 1/8 semitone steps for the
+// lowest octave, so that pitch bend needs only a table lookup and a shift.
+// The table is rebuilt at the next tone update after the PSG virtual clock
+// changes, and sounding notes keep their old period until then. As the
+// original MSX table did, note N is played at the pitch of note N + 24.
+enum {
+  BEND_STEPS = 8,                         // steps per semitone
+  PERIOD_STEPS = 12 * BEND_STEPS,         // steps per octave
+  PERIOD_SHIFT = 2,                       // fractional bits in MIDIPeriod
+  PERIOD_BASE = 32832933UL,               // 2^(16+2) / (32 * 16.3516Hz) in Q16
+  PERIOD_RATIO = 4264068101UL,            // 2^(-1/96) in Q32
+  BEND_CENTER = 0x2000,
+  BEND_RANGE = 2,                         // in semitones
+};
 
-  0xd5d, 0xc9c, 0xbe7, 0xb3c, 0xa9b, 0xa02, 0x973, 0x8eb, 0x86b, 0x7f2, 0x780, 0x714,
-  0x6af, 0x64e, 0x5f4, 0x59e, 0x54e, 0x501, 0x4ba, 0x476, 0x436, 0x3f9, 0x3c0, 0x38a,
-  0x357, 0x327, 0x2fa, 0x2cf, 0x2a7, 0x281, 0x25d, 0x23b, 0x21b, 0x1fd, 0x1e0, 0x1c5,
-  0x1ac, 0x194, 0x17d, 0x168, 0x153, 0x140, 0x12e, 0x11d, 0x10d, 0x0fe, 0x0f0, 0x0e3,
-  0x0d6, 0x0ca, 0x0be, 0x0b4, 0x0aa, 0x0a0, 0x097, 0x08f, 0x087, 0x07f, 0x078, 0x071,
-  0x06b, 0x065, 0x05f, 0x05a, 0x055, 0x050, 0x04c, 0x047, 0x043, 0x040, 0x03c, 0x039,
-  0x035, 0x032, 0x030, 0x02d, 0x02a, 0x028, 0x026, 0x024, 0x022, 0x020, 0x01e, 0x01c,
-  0x01b, 0x019, 0x018, 0x016, 0x015, 0x014, 0x013, 0x012, 0x011, 0x010, 0x00f, 0x00e,
+static HOST_LOCAL uint16_t MIDIPeriod[PERIOD_STEPS];
+static HOST_LOCAL uint32_t MIDIPeriodClock;
 
-  0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
-  0, 0, 0, 0, 0, 0, 0, 0
-};
+typedef struct {
+  uint8_t note;
+  uint8_t velocity;
+  uint8_t volume;
+  uint8_t expression;
+  uint8_t program;
+  uint8_t sustain;
+  uint8_t held;
+  int8_t bend;  // in steps
+} Channel;
+
+#if defined(BUILD_MIDI_LZ)
+// Decoder state for packed songs that tools/smfpack.c produces. The track is
+// coded as LZSS with a 256 byte window. Each flag byte describes following 8
+// items from LSB, 1 for a literal byte, and 0 for a match that consists of
+// a distance - 1 byte, and a length byte in 3 to 255.
+typedef struct {
+  uint8_t window[256];
+  uint8_t pos;
+  uint8_t flags;
+  uint8_t bits;
+  uint8_t length;
+  uint8_t distance;
+} Stream;
+#endif
 
-struct {
+HOST_LOCAL struct {
   const uint8_t* start;
   const uint8_t* cur;
   const uint8_t* end;
@@ -57,31 +88,252 @@ struct {
   uint32_t tick_us;
   uint32_t tick;
   uint16_t division;
+  uint8_t status;
+  Channel channel[3];
+#if defined(BUILD_MIDI_LZ)
+  bool packed;
+  Stream stream;
+#endif
 } MIDIWork;
 
+// Counts rewinds for callers that track loop points. Not a part of the state.
+static HOST_LOCAL uint32_t MIDILoops;
+
+// MIDIWork holds pointers, and 64-bit hosts report their own size.
+#if defined(BUILD_MIDI_LZ) && __SIZEOF_POINTER__ == 4
+#  define iMIDIWorkSize 316
+#elif defined(BUILD_MIDI_LZ)
+#  define iMIDIWorkSize 328
+#elif __SIZEOF_POINTER__ == 4
+#  define iMIDIWorkSize 52
+#else
+#  define iMIDIWorkSize 64
+#endif
+#define iMIDIPeriodSize 196
+_Static_assert(sizeof(MIDIWork) == iMIDIWorkSize, "iMIDIWorkSize");
+_Static_assert(sizeof(MIDIPeriod) + sizeof(MIDIPeriodClock) == iMIDIPeriodSize,
+               "iMIDIPeriodSize");
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#pragma message("MIDIWork: " XSTR(iMIDIWorkSize) " bytes")
+#pragma message("MIDIPeriod: " XSTR(iMIDIPeriodSize) " bytes")
+
+static void MIDIBuildPeriod(uint32_t clock) {
+  MIDIPeriodClock = clock;
+  uint32_t period = ((uint64_t)clock * PERIOD_BASE) >> 16;
+  for (int i = 0; i < PERIOD_STEPS; ++i) {
+    MIDIPeriod[i] = period >> 16;
+    period = ((uint64_t)period * PERIOD_RATIO) >> 32;
+  }
+}
+
+static void MIDIUpdateTone(uint8_t ch) {
+  int16_t index = MIDIWork.channel[ch].note * BEND_STEPS +
+      MIDIWork.channel[ch].bend;
+  if (index < 0)
+    index = 0;
+  uint8_t shift = PERIOD_SHIFT;
+  if (MIDIPeriodClock != PSGGetClock())
+    MIDIBuildPeriod(PSGGetClock());
+  while (index >= PERIOD_STEPS) {
+    index -= PERIOD_STEPS;
+    shift++;
+  }
+  uint32_t tp = (MIDIPeriod[index] + (1 << (shift - 1))) >> shift;
+  if (tp > 0xfff)
+    tp = 0xfff;
+  PSGWrite(ch * 2 + 0, tp & 0xff);
+  PSGWrite(ch * 2 + 1, tp >> 8);
+}
+
+// Maps 0-127 to 0-128 so that 127 is unity gain.
+static uint32_t MIDIGain(uint8_t value) {
+  return value + (value >> 6);
+}
+
+// Volume and expression scale the velocity to level mapping of the original
+// player, velocity >> 3, that channels without them keep.
+static void MIDIUpdateLevel(uint8_t ch) {
+  const Channel* channel = &MIDIWork.channel[ch];
+  uint32_t level = (uint32_t)(channel->velocity >> 3) *
+      MIDIGain(channel->volume) * MIDIGain(channel->expression);
+  PSGWrite(8 + ch, level >> 14);  // 4 + 7 + 7 bits to 4 bits
+}
+
 static void MIDINoteOff(uint8_t ch, uint8_t note, uint8_t velocity) {
-  if (ch > 2)
+  if (note != MIDIWork.channel[ch].note)
     return;
-  PSGWrite(8 + ch, 0);
+  if (MIDIWork.channel[ch].sustain) {
+    MIDIWork.channel[ch].held = 1;
+    return;
+  }
+  MIDIWork.channel[ch].velocity = 0;
+  MIDIUpdateLevel(ch);
 }
 
 static void MIDINoteOn(uint8_t ch, uint8_t note, uint8_t velocity) {
-  if (ch > 2)
+  if (velocity == 0) {
+    MIDINoteOff(ch, note, velocity);
+    return;
+  }
+  MIDIWork.channel[ch].note = note;
+  MIDIWork.channel[ch].velocity = velocity;
+  MIDIWork.channel[ch].held = 0;
+  MIDIUpdateTone(ch);
+  MIDIUpdateLevel(ch);
+}
+
+static void MIDIControlChange(uint8_t ch, uint8_t control, uint8_t value) {
+  switch (control) {
+  case 0x07:  // Channel Volume
+    MIDIWork.channel[ch].volume = value;
+    MIDIUpdateLevel(ch);
+    break;
+  case 0x0b:  // Expression
+    MIDIWork.channel[ch].expression = value;
+    MIDIUpdateLevel(ch);
+    break;
+  case 0x40:  // Sustain
+    MIDIWork.channel[ch].sustain = value >= 0x40;
+    if (!MIDIWork.channel[ch].sustain && MIDIWork.channel[ch].held) {
+      MIDIWork.channel[ch].held = 0;
+      MIDIWork.channel[ch].velocity = 0;
+      MIDIUpdateLevel(ch);
+    }
+    break;
+  }
+}
+
+static void MIDIProgramChange(uint8_t ch, uint8_t program, uint8_t unused) {
+  // PSG has only one timbre. Just keep it as a part of the channel state.
+  MIDIWork.channel[ch].program = program;
+}
+
+static void MIDIPitchBend(uint8_t ch, uint8_t lsb, uint8_t msb) {
+  int32_t bend = (((int32_t)msb << 7) | lsb) - BEND_CENTER;
+  MIDIWork.channel[ch].bend = (bend * BEND_RANGE * BEND_STEPS) >> 13;
+  MIDIUpdateTone(ch);
+}
+
+static void MIDIIgnore(uint8_t ch, uint8_t data1, uint8_t data2) {
+}
+
+// Channel message handlers indexed by status[6:4], with data byte counts.
+static const struct {
+  void (*handler)(uint8_t ch, uint8_t data1, uint8_t data2);
+  uint8_t size;
+} MIDIHandlers[7] = {
+  { MIDINoteOff, 2 },        // 0x8n
+  { MIDINoteOn, 2 },         // 0x9n
+  { MIDIIgnore, 2 },         // 0xAn: Polyphonic Key Pressure
+  { MIDIControlChange, 2 },  // 0xBn
+  { MIDIProgramChange, 1 },  // 0xCn
+  { MIDIIgnore, 1 },         // 0xDn: Channel Pressure
+  { MIDIPitchBend, 2 },      // 0xEn
+};
+
+#if defined(BUILD_MIDI_LZ)
+// Produces one track byte, reading at most 3 bytes from the packed song.
+static uint8_t MIDIDecode() {
+  Stream* stream = &MIDIWork.stream;
+  if (!stream->length) {
+    if (!stream->bits) {
+      stream->flags = *MIDIWork.cur++;
+      stream->bits = 8;
+    }
+    stream->bits--;
+    bool literal = stream->flags & 1;
+    stream->flags >>= 1;
+    if (literal) {
+      uint8_t data = *MIDIWork.cur++;
+      stream->window[stream->pos++] = data;
+      return data;
+    }
+    stream->distance = MIDIWork.cur[0];
+    stream->length = MIDIWork.cur[1];
+    MIDIWork.cur += 2;
+  }
+  stream->length--;
+  uint8_t data = stream->window[(uint8_t)(stream->pos - stream->distance - 1)];
+  stream->window[stream->pos++] = data;
+  return data;
+}
+#endif
+
+static uint8_t MIDIRead() {
+#if defined(BUILD_MIDI_LZ)
+  if (MIDIWork.packed)
+    return MIDIDecode();
+#endif
+  return *MIDIWork.cur++;
+}
+
+static void MIDISkip(uint32_t size) {
+#if defined(BUILD_MIDI_LZ)
+  if (MIDIWork.packed) {
+    while (size--)
+      MIDIDecode();
     return;
-  PSGWrite(ch * 2 + 0, note_param[note] & 0xff);
-  PSGWrite(ch * 2 + 1, note_param[note] >> 8);
-  PSGWrite(8 + ch, velocity >> 3);
+  }
+#endif
+  MIDIWork.cur += size;
+}
+
+static void MIDIRewind() {
+  MIDIWork.cur = MIDIWork.start;
+#if defined(BUILD_MIDI_LZ)
+  MIDIWork.stream.pos = 0;
+  MIDIWork.stream.bits = 0;
+  MIDIWork.stream.length = 0;
+#endif
 }
 
 static uint32_t MIDIDeltaTime() {
   uint32_t delta = 0;
+  uint8_t data;
   do {
-    delta = (delta << 7) | (*MIDIWork.cur & 0x7f);
-  } while ((*MIDIWork.cur++ & 0x80) != 0);
+    data = MIDIRead();
+    delta = (delta << 7) | (data & 0x7f);
+  } while ((data & 0x80) != 0);
   return delta;
 }
 
+static bool MIDIStart() {
+  MIDIRewind();
+  MIDIWork.tick_us = 0;
+  MIDIWork.tick = 0;
+  MIDIWork.tempo = 1000000;
+  MIDIWork.tick_us = MIDIWork.tempo / MIDIWork.division;
+  MIDIWork.status = 0;
+  for (int ch = 0; ch < 3; ++ch) {
+    MIDIWork.channel[ch].note = 0;
+    MIDIWork.channel[ch].velocity = 0;
+    MIDIWork.channel[ch].volume = 127;
+    MIDIWork.channel[ch].expression = 127;
+    MIDIWork.channel[ch].program = 0;
+    MIDIWork.channel[ch].sustain = 0;
+    MIDIWork.channel[ch].held = 0;
+    MIDIWork.channel[ch].bend = 0;
+  }
+  MIDIBuildPeriod(PSGGetClock());
+
+  PSGWrite(7, 0x38);
+  return true;
+}
+
 bool MIDIInit(const uint8_t* data) {
+#if defined(BUILD_MIDI_LZ)
+  MIDIWork.packed =
+      data[0] == 'S' && data[1] == 'C' && data[2] == 'Z' && data[3] == '1';
+  if (MIDIWork.packed) {
+    MIDIWork.division = (data[4] << 8) | data[5];
+    uint32_t size = (data[6] << 24) | (data[7] << 16) | (data[8] << 8) | data[9];
+    MIDIWork.start = &data[10];
+    MIDIWork.end = &data[10 + size - 1];
+    return MIDIStart();
+  }
+#endif
   if (data[0] != 'M' || data[1] != 'T' || data[2] != 'h' || data[3] != 'd')
     return false;  // invalid magic
   if (data[4] != 0 || data[5] != 0 || data[6] != 0 || data[7] != 6)
@@ -93,15 +345,9 @@ bool MIDIInit(const uint8_t* data) {
     return false;  // invalid magic
   uint32_t size =
       (data[18] << 24) | (data[19] << 16) | (data[20] << 8) | data[21];
-  MIDIWork.start = MIDIWork.cur = &data[22];
+  MIDIWork.start = &data[22];
   MIDIWork.end = &data[22 + size - 1];
-  MIDIWork.tick_us = 0;
-  MIDIWork.tick = 0;
-  MIDIWork.tempo = 1000000;
-  MIDIWork.tick_us = MIDIWork.tempo / MIDIWork.division;
-
-  PSGWrite(7, 0x38);
-  return true;
+  return MIDIStart();
 }
 
 bool MIDIUpdate(uint16_t tick_us, bool repeat, uint16_t gap) {
@@ -114,41 +360,74 @@ bool MIDIUpdate(uint16_t tick_us, bool repeat, uint16_t gap) {
     }
     tick_us -= MIDIWork.tick;
     MIDIWork.tick = 0;
-    uint8_t status = *MIDIWork.cur++;
-    switch (status & 0xf0) {
-      case 0x80:
-        MIDINoteOff(status & 0x0f, MIDIWork.cur[0], MIDIWork.cur[1]);
-        MIDIWork.cur += 2;
-        break;
-      case 0x90:
-        MIDINoteOn(status & 0x0f, MIDIWork.cur[0], MIDIWork.cur[1]);
-        MIDIWork.cur += 2;
-        break;
-      case 0xf0:
-        if (status == 0xff) {
-          uint8_t type = *MIDIWork.cur++;
-          uint8_t size = *MIDIWork.cur++;
-          if (type == 0x2f && size == 0) {
-            if (!repeat)
-              return false;
-            MIDIWork.cur = MIDIWork.start;
-            MIDIWork.tick = (MIDIDeltaTime() + gap) * MIDIWork.tick_us;
-          } else if (type == 0x51 && size == 3) {
-            MIDIWork.tempo = (MIDIWork.cur[0] << 16) | (MIDIWork.cur[1] << 8) |
-                (MIDIWork.cur[2]);
-            MIDIWork.tick_us = MIDIWork.tempo / MIDIWork.division;
-            MIDIWork.cur += 3;
-          } else {
-            MIDIWork.cur += size;
-          }
-          break;
-        }
-        // no break
-      default:
-        // not impl.
-        // printf("$%02x\n", status);
-        return false;
+    uint8_t status = MIDIRead();
+    uint8_t data1 = 0;
+    bool running = !(status & 0x80);
+    if (running) {
+      if (!MIDIWork.status)
+        return false;  // data byte without status
+      data1 = status;
+      status = MIDIWork.status;
+    }
+    if (status < 0xf0) {
+      MIDIWork.status = status;
+      uint8_t ch = status & 0x0f;
+      uint8_t type = (status >> 4) & 0x07;
+      if (!running)
+        data1 = MIDIRead();
+      uint8_t data2 = MIDIHandlers[type].size == 2 ? MIDIRead() : 0;
+      if (ch < 3)
+        MIDIHandlers[type].handler(ch, data1, data2);
+      continue;
+    }
+    // System exclusive and meta events cancel running status.
+    MIDIWork.status = 0;
+    if (status == 0xf0 || status == 0xf7) {
+      MIDISkip(MIDIDeltaTime());
+    } else if (status == 0xff) {
+      uint8_t type = MIDIRead();
+      uint32_t size = MIDIDeltaTime();
+      if (type == 0x2f && size == 0) {
+        if (!repeat)
+          return false;
+        MIDIRewind();
+        MIDILoops++;
+        MIDIWork.tick = (MIDIDeltaTime() + gap) * MIDIWork.tick_us;
+#if defined(BUILD_LOOP_CACHE)
+        // Loops start at a call boundary so that every pass runs in the same
+        // timing, i.e. the rest of |tick_us| is dropped.
+        if (MIDIWork.tick)
+          return true;
+#endif
+      } else if (type == 0x51 && size == 3) {
+        MIDIWork.tempo = (uint32_t)MIDIRead() << 16;
+        MIDIWork.tempo |= (uint32_t)MIDIRead() << 8;
+        MIDIWork.tempo |= MIDIRead();
+        MIDIWork.tick_us = MIDIWork.tempo / MIDIWork.division;
+      } else {
+        MIDISkip(size);
+      }
+    } else {
+      // not impl.
+      // printf("$%02x\n", status);
+      return false;
     }
   }
   return true;
 }
+
+uint32_t MIDIGetLoops() {
+  return MIDILoops;
+}
+
+uint32_t MIDIStateSize() {
+  return sizeof(MIDIWork);
+}
+
+void MIDISave(uint8_t* state) {
+  memcpy(state, &MIDIWork, sizeof(MIDIWork));
+}
+
+void MIDILoad(const uint8_t* state) {
+  memcpy(&MIDIWork, state, sizeof(MIDIWork));
+}
@@ -0,0 +1,117 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef __MeterWork_h__
+#define __MeterWork_h__
+
+#include <stdint.h>
+#include <string.h>
+
+#include "Meter.h"
+
+// The mix is measured at every sample, and voices are sampled every
+// 2^METER_STEP_SHIFT samples. Levels are latched every 2^METER_WINDOW_SHIFT
+// voice samples. METER_CLIP is the largest value the DAC takes.
+#if !defined(METER_STEP_SHIFT)
+#  define METER_STEP_SHIFT 5
+#endif
+#if !defined(METER_WINDOW_SHIFT)
+#  define METER_WINDOW_SHIFT 8
+#endif
+#if !defined(METER_CLIP)
+#  define METER_CLIP 1023
+#endif
+
+typedef struct {
+  uint64_t square;
+  uint32_t count;
+  uint16_t peak;
+} MeterSum;
+
+static inline void MeterAdd(MeterSum* sum, uint32_t level) {
+  if (level > sum->peak)
+    sum->peak = level;
+  sum->square += level * level;
+  sum->count++;
+}
+
+static inline uint16_t MeterSqrt(uint32_t value) {
+  uint32_t root = 0;
+  for (uint32_t bit = 1UL << 30; bit; bit >>= 2) {
+    if (value >= root + bit) {
+      value -= root + bit;
+      root = (root >> 1) + bit;
+    } else {
+      root >>= 1;
+    }
+  }
+  return root;
+}
+
+// Turns |sum| of 2^|shift| samples into |level|, and starts the next window.
+// A window that was not sampled throughout, e.g. while the loop cache plays,
+// keeps the last level instead of reporting silence. |level->clips| is kept,
+// as it counts over windows.
+static inline void MeterLatch(MeterSum* sum, MeterLevel* level,
+                              uint32_t shift) {
+  if (sum->count == 1UL << shift) {
+    level->peak = sum->peak;
+    level->rms = MeterSqrt(sum->square >> shift);
+  }
+  sum->square = 0;
+  sum->count = 0;
+  sum->peak = 0;
+}
+
+// Levels are published under an even to odd to even |sequence| so that
+// readers on other threads can copy a consistent set without locks. There
+// should be one writer per |sequence|. Bus interrupts should read single
+// fields instead, as they may interrupt the writer.
+static inline void MeterBeginPublish(volatile uint32_t* sequence) {
+  ++*sequence;
+  __sync_synchronize();
+}
+
+static inline void MeterEndPublish(volatile uint32_t* sequence) {
+  __sync_synchronize();
+  ++*sequence;
+}
+
+static inline void MeterCopy(const volatile uint32_t* sequence, void* to,
+                             const volatile void* from, uint32_t size) {
+  uint32_t begin;
+  do {
+    begin = *sequence;
+    __sync_synchronize();
+    memcpy(to, (const void*)from, size);
+    __sync_synchronize();
+  } while ((begin & 1) || begin != *sequence);
+}
+
+#endif // __MeterWork_h__
@@ -27,14 +27,32 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
+// BuildConfig.h comes first, as PSG.h declares functions by build options.
+#include "BuildConfig.h"
 #include "PSG.h"
 
+#include <stddef.h>
+#include <string.h>
+
+#include "Counter.h"
+#include "Host.h"
+#include "MeterWork.h"
+#include "PSGWork.h"
+
 // Constant variables to improve readability.
 enum {
   CLK_MSX =  3579545UL,
   CLK_4MHZ = 4000000UL,
 };
 
+// BUILD_FUSED renders PSG and SCC in one accumulator, and expects PSG output
+// levels to be premultiplied for the mix. See PSGSCCUpdate.S.
+#if defined(BUILD_FUSED)
+#  define OUT_SHIFT 5
+#else
+#  define OUT_SHIFT 0
+#endif
+
 const uint16_t vt[32] = {
     0x00, 0x00, 0x01, 0x01, 0x02, 0x02, 0x03, 0x04,
     0x05, 0x06, 0x07, 0x08, 0x09, 0x0b, 0x0d, 0x10,
@@ -42,6 +60,75 @@ const uint16_t vt[32] = {
     0x4c, 0x5a, 0x6b, 0x80, 0x98, 0xb4, 0xd6, 0xff
 };
 
+#if defined(BUILD_PSG_MIXTABLE)
+// The real output stage does not add channel levels linearly. With
+// BUILD_PSG_MIXTABLE, each voice contributes its 4-bit level to a 12-bit
+// index, and the kernel looks up the combined output here. The table is
+// modeled as channel outputs driving a shared load, and takes 8KB of RAM.
+enum {
+  MIX_LOAD = 0x1fe,  // Load against the full level of one channel, 0xff.
+};
+
+HOST_LOCAL uint16_t PSGMixTable[16 * 16 * 16];
+
+static void PSGBuildMixTable() {
+  for (uint32_t a = 0; a < 16; ++a) {
+    for (uint32_t b = 0; b < 16; ++b) {
+      for (uint32_t c = 0; c < 16; ++c) {
+        uint32_t sum = vt[1 + (a << 1)] + vt[1 + (b << 1)] + vt[1 + (c << 1)];
+        uint32_t out = (0xff + MIX_LOAD) * sum / (sum + MIX_LOAD);
+        PSGMixTable[(a << 8) | (b << 4) | c] = out << OUT_SHIFT;
+      }
+    }
+  }
+}
+#endif
+
+// Register writes only store raw values and raise flags. PSGFlush() derives
+// synthesizer parameters from them. Flags are per item bytes, and each
+// is cleared before the values it guards are read, so that bus interrupts
+// never race with clearing them.
+enum {
+  DIRTY_CH_A,
+  DIRTY_CH_B,
+  DIRTY_CH_C,
+  DIRTY_NOISE,
+  DIRTY_MIXER,
+  DIRTY_ANY,
+  DIRTY_SIZE,
+};
+
+#if defined(BUILD_PACKED)
+typedef struct {
+  uint32_t limit;
+  uint32_t count;
+  uint16_t tp;
+  uint16_t out;
+  uint8_t on;
+  uint8_t tone;
+  uint8_t noise;
+  uint8_t ml;
+} Synth;
+
+typedef struct {
+  uint32_t limit;
+  uint32_t count;
+  uint16_t seed;
+  uint8_t np;
+} Noise;
+
+HOST_LOCAL struct {
+  uint32_t step;
+  Synth synth[3];
+  Noise noise;
+
+  uint32_t fout;
+  uint8_t mixer;
+  uint8_t dirty[DIRTY_SIZE];
+} PSGWork;
+
+#  define CHANNEL(ch) PSGWork.synth[ch]
+#else
 typedef struct {
   uint16_t tp;
   uint16_t ml;
@@ -63,15 +150,47 @@ typedef struct {
   uint32_t seed;
 } Noise;
 
-struct {
+HOST_LOCAL struct {
   uint32_t step;
   Synth synth[3];
   Noise noise;
 
   uint32_t fout;
   Channel channel[3];
+  uint8_t mixer;
+  uint8_t dirty[DIRTY_SIZE];
 } PSGWork;
 
+#  define CHANNEL(ch) PSGWork.channel[ch]
+#endif
+
+// Keep PSGWork.h in sync with the structures above.
+_Static_assert(offsetof(Synth, limit) == iPSGSynthLimit, "iPSGSynthLimit");
+_Static_assert(offsetof(Synth, count) == iPSGSynthCount, "iPSGSynthCount");
+_Static_assert(offsetof(Synth, on) == iPSGSynthOn, "iPSGSynthOn");
+_Static_assert(offsetof(Synth, out) == iPSGSynthOut, "iPSGSynthOut");
+_Static_assert(offsetof(Synth, tone) == iPSGSynthTone, "iPSGSynthTone");
+_Static_assert(offsetof(Synth, noise) == iPSGSynthNoise, "iPSGSynthNoise");
+_Static_assert(sizeof(Synth) == iPSGSynthSize, "iPSGSynthSize");
+_Static_assert(offsetof(Noise, limit) == iPSGNoiseLimit, "iPSGNoiseLimit");
+_Static_assert(offsetof(Noise, count) == iPSGNoiseCount, "iPSGNoiseCount");
+_Static_assert(offsetof(Noise, seed) == iPSGNoiseSeed, "iPSGNoiseSeed");
+_Static_assert(sizeof(Noise) == iPSGNoiseSize, "iPSGNoiseSize");
+_Static_assert(offsetof(__typeof__(PSGWork), step) == iPSGStep, "iPSGStep");
+_Static_assert(offsetof(__typeof__(PSGWork), synth) == iPSGSynth, "iPSGSynth");
+_Static_assert(offsetof(__typeof__(PSGWork), noise) == iPSGNoise, "iPSGNoise");
+_Static_assert(offsetof(__typeof__(PSGWork), fout) == iPSGFout, "iPSGFout");
+_Static_assert(sizeof(PSGWork) == iPSGWorkSize, "iPSGWorkSize");
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#pragma message("PSGWork: " XSTR(iPSGWorkSize) " bytes")
+#if defined(BUILD_PSG_MIXTABLE)
+#define iPSGMixTableSize 8192
+_Static_assert(sizeof(PSGMixTable) == iPSGMixTableSize, "iPSGMixTableSize");
+#pragma message("PSGMixTable: " XSTR(iPSGMixTableSize) " bytes")
+#endif
+
 void PSGInit(uint32_t sample_rate) {
   PSGWork.step = CLK_MSX;
   PSGWork.fout = sample_rate;
@@ -86,57 +205,53 @@ void PSGInit(uint32_t sample_rate) {
   PSGWork.noise.limit = 0;
   PSGWork.noise.count = 0;
   PSGWork.noise.seed = 0xffff;
+#if defined(BUILD_PSG_MIXTABLE)
+  PSGBuildMixTable();
+#endif
+  for (int i = 0; i < DIRTY_SIZE; ++i)
+    PSGWork.dirty[i] = 0;
+}
+
+static void PSGMarkDirty(int index) {
+  PSGWork.dirty[index] = 1;
+  PSGWork.dirty[DIRTY_ANY] = 1;
+}
+
+// The barrier keeps the clear before loads of the values that the flag
+// guards, so that a write landing in between raises the flag again.
+static void PSGClearDirty(int index) {
+  PSGWork.dirty[index] = 0;
+  __asm__ volatile("" ::: "memory");
 }
 
 bool PSGWrite(uint8_t reg, uint8_t value) {
   switch (reg) {
   case 0x00:  // TP[7:0] for Ch.A
-    PSGWork.channel[0].tp = (PSGWork.channel[0].tp & 0x0f00) | value;
-    PSGWork.synth[0].limit = (uint32_t)PSGWork.channel[0].tp * 16 * PSGWork.fout;
-    break;
-  case 0x01:  // TP[11:8] for Ch.A
-    PSGWork.channel[0].tp = (PSGWork.channel[0].tp & 0x00ff) | ((uint16_t)(value & 0x0f) << 8);
-    PSGWork.synth[0].limit = (uint32_t)PSGWork.channel[0].tp * 16 * PSGWork.fout;
-    break;
   case 0x02:  // TP[7:0] for Ch.B
-    PSGWork.channel[1].tp = (PSGWork.channel[1].tp & 0x0f00) | value;
-    PSGWork.synth[1].limit = (uint32_t)PSGWork.channel[1].tp * 16 * PSGWork.fout;
-    break;
-  case 0x03:  // TP[11:8] for Ch.B
-    PSGWork.channel[1].tp = (PSGWork.channel[1].tp & 0x00ff) | ((uint16_t)(value & 0x0f) << 8);
-    PSGWork.synth[1].limit = (uint32_t)PSGWork.channel[1].tp * 16 * PSGWork.fout;
-    break;
   case 0x04:  // TP[7:0] for Ch.C
-    PSGWork.channel[2].tp = (PSGWork.channel[2].tp & 0x0f00) | value;
-    PSGWork.synth[2].limit = (uint32_t)PSGWork.channel[2].tp * 16 * PSGWork.fout;
+    CHANNEL(reg >> 1).tp = (CHANNEL(reg >> 1).tp & 0x0f00) | value;
+    PSGMarkDirty(DIRTY_CH_A + (reg >> 1));
     break;
+  case 0x01:  // TP[11:8] for Ch.A
+  case 0x03:  // TP[11:8] for Ch.B
   case 0x05:  // TP[11:8] for Ch.C
-    PSGWork.channel[2].tp = (PSGWork.channel[2].tp & 0x00ff) | ((uint16_t)(value & 0x0f) << 8);
-    PSGWork.synth[2].limit = (uint32_t)PSGWork.channel[2].tp * 16 * PSGWork.fout;
+    CHANNEL(reg >> 1).tp =
+        (CHANNEL(reg >> 1).tp & 0x00ff) | ((uint16_t)(value & 0x0f) << 8);
+    PSGMarkDirty(DIRTY_CH_A + (reg >> 1));
     break;
   case 0x06:  // NP[4:0]
     PSGWork.noise.np = value & 0x1f;
-    PSGWork.noise.limit = (uint32_t)PSGWork.noise.np * 2 * 16 * PSGWork.fout;
+    PSGMarkDirty(DIRTY_NOISE);
     break;
   case 0x07:  // MIXER
-    PSGWork.synth[0].tone = !!(value & (1 << 0));
-    PSGWork.synth[1].tone = !!(value & (1 << 1));
-    PSGWork.synth[2].tone = !!(value & (1 << 2));
-    PSGWork.synth[0].noise = !!(value & (1 << 3));
-    PSGWork.synth[1].noise = !!(value & (1 << 4));
-    PSGWork.synth[2].noise = !!(value & (1 << 5));
+    PSGWork.mixer = value;
+    PSGMarkDirty(DIRTY_MIXER);
     break;
   case 0x08:  // M/L[3:0] for Ch.A
-    PSGWork.channel[0].ml = value & 0x1f;
-    PSGWork.synth[0].out = vt[1 + ((PSGWork.channel[0].ml & 0x0f) << 1)];
-    break;
   case 0x09:  // M/L[3:0] for Ch.B
-    PSGWork.channel[1].ml = value & 0x1f;
-    PSGWork.synth[1].out = vt[1 + ((PSGWork.channel[1].ml & 0x0f) << 1)];
-    break;
   case 0x0a:  // M/L[3:0] for Ch.C
-    PSGWork.channel[2].ml = value & 0x1f;
-    PSGWork.synth[2].out = vt[1 + ((PSGWork.channel[2].ml & 0x0f) << 1)];
+    CHANNEL(reg - 0x08).ml = value & 0x1f;
+    PSGMarkDirty(DIRTY_CH_A + (reg - 0x08));
     break;
   case 0x0b:  // EP[7:0]
   case 0x0c:  // EP[15:8]
@@ -158,8 +273,157 @@ bool PSGWrite(uint8_t reg, uint8_t value) {
   return true;
 }
 
+bool PSGFlush() {
+  if (!PSGWork.dirty[DIRTY_ANY])
+    return false;
+  PSGClearDirty(DIRTY_ANY);
+  for (int ch = 0; ch < 3; ++ch) {
+    if (!PSGWork.dirty[DIRTY_CH_A + ch])
+      continue;
+    PSGClearDirty(DIRTY_CH_A + ch);
+    PSGWork.synth[ch].limit = (uint32_t)CHANNEL(ch).tp * 16 * PSGWork.fout;
+#if defined(BUILD_PSG_MIXTABLE)
+    PSGWork.synth[ch].out = (CHANNEL(ch).ml & 0x0f) << ((2 - ch) * 4);
+#else
+    PSGWork.synth[ch].out = vt[1 + ((CHANNEL(ch).ml & 0x0f) << 1)] << OUT_SHIFT;
+#endif
+  }
+  if (PSGWork.dirty[DIRTY_NOISE]) {
+    PSGClearDirty(DIRTY_NOISE);
+    PSGWork.noise.limit = (uint32_t)PSGWork.noise.np * 2 * 16 * PSGWork.fout;
+  }
+  if (PSGWork.dirty[DIRTY_MIXER]) {
+    PSGClearDirty(DIRTY_MIXER);
+    uint8_t value = PSGWork.mixer;
+    PSGWork.synth[0].tone = !!(value & (1 << 0));
+    PSGWork.synth[1].tone = !!(value & (1 << 1));
+    PSGWork.synth[2].tone = !!(value & (1 << 2));
+    PSGWork.synth[0].noise = !!(value & (1 << 3));
+    PSGWork.synth[1].noise = !!(value & (1 << 4));
+    PSGWork.synth[2].noise = !!(value & (1 << 5));
+  }
+  return true;
+}
+
+#if defined(BUILD_HOST)
+// C version of PSGUpdate.S. Results should be identical.
+int16_t PSGUpdate() {
+  uint32_t step = PSGWork.step;
+  uint32_t count = PSGWork.noise.count + step;
+  PSGWork.noise.count = count;
+  if (count <= PSGWork.noise.limit) {
+    PSGWork.noise.count = count - PSGWork.noise.limit;
+    uint32_t seed = PSGWork.noise.seed;
+    uint32_t bit = seed & 9;
+    bit ^= bit >> 3;
+    PSGWork.noise.seed = ((seed >> 1) | (bit << 15)) & 0xffff;
+  }
+  uint32_t noise = PSGWork.noise.seed & 1;
+  uint32_t out = 0;
+  for (int ch = 0; ch < 3; ++ch) {
+    Synth* synth = &PSGWork.synth[ch];
+    count = synth->count + step;
+    synth->count = count;
+    if (count <= synth->limit) {
+      synth->count = count - synth->limit;
+      synth->on = ~synth->on;
+    }
+    if (!(synth->on | synth->tone) || !(synth->noise | noise))
+      out += synth->out;
+  }
+#if defined(BUILD_PSG_MIXTABLE)
+  out = PSGMixTable[out];
+#endif
+  return out;
+}
+#endif
+
+bool PSGIsDirty() {
+  return PSGWork.dirty[DIRTY_ANY];
+}
+
+bool PSGIsDeferred(uint8_t reg) {
+  return reg <= 0x0a;
+}
+
+void PSGSkip(uint32_t samples) {
+  uint32_t step = PSGWork.step;
+  for (int ch = 0; ch < 3; ++ch) {
+    Synth* synth = &PSGWork.synth[ch];
+    if (CounterSkip(&synth->count, synth->limit, step, samples) & 1)
+      synth->on = ~synth->on;
+  }
+  uint32_t shifts = CounterSkip(
+      &PSGWork.noise.count, PSGWork.noise.limit, step, samples);
+  uint32_t seed = PSGWork.noise.seed;
+  while (shifts--) {
+    uint32_t bit = seed & 9;
+    bit ^= bit >> 3;
+    seed = ((seed >> 1) | (bit << 15)) & 0xffff;
+  }
+  PSGWork.noise.seed = seed;
+}
+
+void PSGResetPhase() {
+  for (int ch = 0; ch < 3; ++ch) {
+    PSGWork.synth[ch].count = 0;
+    PSGWork.synth[ch].on = 0;
+  }
+  PSGWork.noise.count = 0;
+  PSGWork.noise.seed = 0xffff;
+}
+
+#if defined(BUILD_METER)
+// Voice levels ignore the mix table and premultiplication, and are in vt[]
+// units. Writes to the bus are reflected once they are flushed. |level|
+// keeps the last latched levels for bus reads.
+HOST_LOCAL struct {
+  MeterSum sum[3];
+  MeterLevel level[3];
+} PSGMeterWork;
+
+#define iPSGMeterWorkSize 72
+_Static_assert(sizeof(PSGMeterWork) == iPSGMeterWorkSize, "iPSGMeterWorkSize");
+#pragma message("PSGMeterWork: " XSTR(iPSGMeterWorkSize) " bytes")
+
+void PSGMeter() {
+  uint32_t noise = PSGWork.noise.seed & 1;
+  for (int ch = 0; ch < 3; ++ch) {
+    Synth* synth = &PSGWork.synth[ch];
+    uint32_t level = 0;
+    if (!(synth->on | synth->tone) || !(synth->noise | noise))
+      level = vt[1 + ((CHANNEL(ch).ml & 0x0f) << 1)];
+    MeterAdd(&PSGMeterWork.sum[ch], level);
+  }
+}
+
+void PSGLatchMeters(MeterLevel* levels) {
+  for (int ch = 0; ch < 3; ++ch) {
+    MeterLatch(&PSGMeterWork.sum[ch], &PSGMeterWork.level[ch],
+               METER_WINDOW_SHIFT);
+    levels[ch] = PSGMeterWork.level[ch];
+  }
+}
+#endif
+
+uint32_t PSGGetClock() {
+  return PSGWork.step;
+}
+
 bool PSGRead(uint8_t reg, uint8_t* value) {
   switch (reg) {
+#if defined(BUILD_METER)
+  case 0xe0:  // Ch.A peak
+  case 0xe1:  // Ch.B peak
+  case 0xe2:  // Ch.C peak
+    *value = PSGMeterWork.level[reg - 0xe0].peak;
+    break;
+  case 0xe4:  // Ch.A RMS
+  case 0xe5:  // Ch.B RMS
+  case 0xe6:  // Ch.C RMS
+    *value = PSGMeterWork.level[reg - 0xe4].rms;
+    break;
+#endif
   case 0xfe:  // minor version
     *value = 1;
     break;
@@ -171,3 +435,15 @@ bool PSGRead(uint8_t reg, uint8_t* value) {
   }
   return true;
 }
+
+uint32_t PSGStateSize() {
+  return sizeof(PSGWork);
+}
+
+void PSGSave(uint8_t* state) {
+  memcpy(state, &PSGWork, sizeof(PSGWork));
+}
+
+void PSGLoad(const uint8_t* state) {
+  memcpy(&PSGWork, state, sizeof(PSGWork));
+}
@@ -0,0 +1,185 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef __PSGWork_h__
+#define __PSGWork_h__
+
+// Memory layout of PSGWork shared by PSG.c and the assembly kernels.
+// BUILD_PACKED selects narrower fields for small RAM parts, and merges
+// per-channel register values into Synth.
+
+#define iPSGStep 0
+#define iPSGSynth 4
+
+#if defined(BUILD_PACKED)
+
+#define iPSGSynthLimit 0
+#define iPSGSynthCount 4
+#define iPSGSynthTp 8
+#define iPSGSynthOut 10
+#define iPSGSynthOn 12
+#define iPSGSynthTone 13
+#define iPSGSynthNoise 14
+#define iPSGSynthMl 15
+#define iPSGSynthSize 16
+
+#define iPSGNoiseLimit 0
+#define iPSGNoiseCount 4
+#define iPSGNoiseSeed 8
+#define iPSGNoiseNp 10
+#define iPSGNoiseSize 12
+
+#define iPSGWorkSize 76
+
+#if defined(__ASSEMBLER__)
+#define ldrPSGOn ldrb
+#define strPSGOn strb
+#define ldrPSGOut ldrh
+#define ldrPSGTone ldrb
+#define ldrPSGNoise ldrb
+#define ldrPSGSeed ldrh
+#define strPSGSeed strh
+#endif
+
+#else  // !defined(BUILD_PACKED)
+
+#define iPSGSynthLimit 0
+#define iPSGSynthCount 4
+#define iPSGSynthOn 8
+#define iPSGSynthOut 12
+#define iPSGSynthTone 16
+#define iPSGSynthNoise 20
+#define iPSGSynthSize 24
+
+#define iPSGNoiseNp 0
+#define iPSGNoiseLimit 4
+#define iPSGNoiseCount 8
+#define iPSGNoiseSeed 12
+#define iPSGNoiseSize 16
+
+#define iPSGWorkSize 116
+
+#if defined(__ASSEMBLER__)
+#define ldrPSGOn ldr
+#define strPSGOn str
+#define ldrPSGOut ldr
+#define ldrPSGTone ldr
+#define ldrPSGNoise ldr
+#define ldrPSGSeed ldr
+#define strPSGSeed str
+#endif
+
+#endif  // defined(BUILD_PACKED)
+
+#define iPSGSynth0 iPSGSynth
+#define iPSGSynth1 (iPSGSynth0 + iPSGSynthSize)
+#define iPSGSynth2 (iPSGSynth1 + iPSGSynthSize)
+
+#define iPSGNoise (iPSGSynth2 + iPSGSynthSize)
+#define iPSGFout (iPSGNoise + iPSGNoiseSize)
+
+#if defined(__ASSEMBLER__)
+// Kernel building blocks. Includers define rOut, rWork, rStep, rNoise, and
+// rTmp1-3 before including this file. rWork should point PSGWork, and rOut
+// accumulates the output. PSGUpdateTones may move rWork, and expects rOut to
+// be zero on entry if BUILD_PSG_MIXTABLE is defined.
+
+.macro PSGUpdateNoise
+  ldr  rTmp1, [rWork, #(iPSGNoise + iPSGNoiseCount)]
+  add  rTmp1, rTmp1, rStep
+  str  rTmp1, [rWork, #(iPSGNoise + iPSGNoiseCount)]
+  ldr  rTmp2, [rWork, #(iPSGNoise + iPSGNoiseLimit)]
+  subs rTmp3, rTmp1, rTmp2
+  ldrPSGSeed rTmp1, [rWork, #(iPSGNoise + iPSGNoiseSeed)]
+  bhi  1f
+  str  rTmp3, [rWork, #(iPSGNoise + iPSGNoiseCount)]
+  movs rTmp2, #9
+  ands rTmp2, rTmp2, rTmp1
+  lsrs rTmp3, rTmp2, #3
+  eors rTmp2, rTmp2, rTmp3
+  lsls rTmp2, rTmp2, #15
+  lsrs rTmp1, rTmp1, #1
+  orrs rTmp1, rTmp1, rTmp2
+  uxth rTmp1, rTmp1
+  strPSGSeed rTmp1, [rWork, #(iPSGNoise + iPSGNoiseSeed)]
+1:
+  movs rNoise, #1
+  ands rNoise, rNoise, rTmp1
+.endm
+
+.macro PSGUpdateTone base
+  ldr  rTmp1, [rWork, #(\base + iPSGSynthCount)]
+  add  rTmp1, rTmp1, rStep
+  str  rTmp1, [rWork, #(\base + iPSGSynthCount)]
+  ldr  rTmp2, [rWork, #(\base + iPSGSynthLimit)]
+  subs rTmp3, rTmp1, rTmp2
+  ldrPSGOn rTmp1, [rWork, #(\base + iPSGSynthOn)]
+  bhi  1f
+  str  rTmp3, [rWork, #(\base + iPSGSynthCount)]
+  mvns rTmp1, rTmp1
+#if defined(BUILD_PACKED)
+  uxtb rTmp1, rTmp1
+#endif
+  strPSGOn rTmp1, [rWork, #(\base + iPSGSynthOn)]
+1:
+  ldrPSGTone rTmp2, [rWork, #(\base + iPSGSynthTone)]
+  orrs rTmp1, rTmp1, rTmp2
+  beq  1f
+  ldrPSGNoise rTmp1, [rWork, #(\base + iPSGSynthNoise)]
+  orrs rTmp1, rTmp1, rNoise
+  bne  2f
+1:
+  ldrPSGOut rTmp1, [rWork, #(\base + iPSGSynthOut)]
+  add  rOut, rOut, rTmp1
+2:
+.endm
+
+.macro PSGUpdateTones
+#if defined(BUILD_PACKED)
+  // Byte fields are out of the immediate offset range for Synth 1 and 2.
+  PSGUpdateTone iPSGSynth
+  adds rWork, rWork, #iPSGSynthSize
+  PSGUpdateTone iPSGSynth
+  adds rWork, rWork, #iPSGSynthSize
+  PSGUpdateTone iPSGSynth
+#else
+  PSGUpdateTone iPSGSynth0
+  PSGUpdateTone iPSGSynth1
+  PSGUpdateTone iPSGSynth2
+#endif
+#if defined(BUILD_PSG_MIXTABLE)
+  // Levels are summed into a table index. See PSGMixTable in PSG.c.
+  lsls rOut, rOut, #1
+  ldr  rTmp1, =#PSGMixTable
+  ldrh rOut, [rTmp1, rOut]
+#endif
+.endm
+#endif  // defined(__ASSEMBLER__)
+
+#endif  // __PSGWork_h__
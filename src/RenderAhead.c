@@ -0,0 +1,208 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include "RenderAhead.h"
+
+#include "BuildConfig.h"
+#include "SoundCortex.h"
+
+#if defined(BUILD_RENDER_AHEAD)
+
+#if !defined(RENDER_AHEAD_LOG)
+#  define RENDER_AHEAD_LOG 64
+#endif
+
+typedef struct {
+  uint32_t time;
+  uint8_t chip;
+  uint8_t reg;
+  uint8_t value;
+} Write;
+
+// Writes are sorted by time, and kept while a rollback may replay them.
+struct {
+  uint16_t* buffer;
+  uint32_t capacity;
+  uint8_t* snapshots;
+  uint32_t count;
+  uint32_t interval;
+  uint32_t size;
+  uint32_t cursor;
+  uint32_t rendered;
+  uint32_t next;
+  uint32_t writes;
+  Write write[RENDER_AHEAD_LOG];
+  RenderAheadStats stats;
+} RenderAheadWork;
+
+// RenderAheadWork holds pointers, and 64-bit hosts report their own size.
+// Buffers and snapshots are given by the caller.
+#if __SIZEOF_POINTER__ == 4
+#  define iRenderAheadWorkBase 60
+#else
+#  define iRenderAheadWorkBase 72
+#endif
+_Static_assert(sizeof(RenderAheadWork) ==
+               RENDER_AHEAD_LOG * 8 + iRenderAheadWorkBase, "RenderAheadWork");
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#pragma message("RenderAheadWork: " XSTR(RENDER_AHEAD_LOG) " x 8 + " \
+                XSTR(iRenderAheadWorkBase) " bytes")
+
+static uint8_t* RenderAheadSnapshot(uint32_t position) {
+  uint32_t index = position / RenderAheadWork.interval % RenderAheadWork.count;
+  return &RenderAheadWork.snapshots[index * RenderAheadWork.size];
+}
+
+static uint32_t RenderAheadFind(uint32_t time) {
+  uint32_t i = 0;
+  while (i < RenderAheadWork.writes && RenderAheadWork.write[i].time < time)
+    i++;
+  return i;
+}
+
+static void RenderAheadApply(const Write* write) {
+  SoundCortexWrite(write->chip, write->reg, write->value);
+}
+
+// Samples before the cursor are already played. Runs them again without
+// rendering, with writes from the log applied where RenderAheadFill() did.
+static void RenderAheadAdvance(uint32_t start, uint32_t end) {
+  uint32_t pos = start;
+  while (RenderAheadWork.next < RenderAheadWork.writes &&
+         RenderAheadWork.write[RenderAheadWork.next].time < end) {
+    uint32_t time = RenderAheadWork.write[RenderAheadWork.next].time;
+    SoundCortexAdvance(time - pos);
+    pos = time;
+    RenderAheadApply(&RenderAheadWork.write[RenderAheadWork.next++]);
+  }
+  SoundCortexAdvance(end - pos);
+}
+
+void RenderAheadInit(uint16_t* buffer, uint32_t capacity,
+                     uint8_t* snapshots, uint32_t count, uint32_t interval) {
+  RenderAheadWork.buffer = buffer;
+  RenderAheadWork.capacity = capacity;
+  RenderAheadWork.snapshots = snapshots;
+  RenderAheadWork.count = count;
+  RenderAheadWork.interval = interval;
+  RenderAheadWork.size = SoundCortexStateSize();
+  RenderAheadWork.cursor = 0;
+  RenderAheadWork.rendered = 0;
+  RenderAheadWork.next = 0;
+  RenderAheadWork.writes = 0;
+  RenderAheadStats empty = { 0 };
+  RenderAheadWork.stats = empty;
+}
+
+uint32_t RenderAheadFill() {
+  uint32_t interval = RenderAheadWork.interval;
+  uint32_t cursor = RenderAheadWork.cursor;
+  // A snapshot slot can be reused once the cursor passes the next one.
+  uint32_t limit = (cursor / interval + RenderAheadWork.count - 1) * interval;
+  if (limit > cursor + RenderAheadWork.capacity)
+    limit = cursor + RenderAheadWork.capacity;
+  uint32_t start = RenderAheadWork.rendered;
+  for (uint32_t pos = start; pos < limit; ++pos) {
+    if (pos % interval == 0)
+      SoundCortexSave(RenderAheadSnapshot(pos));
+    while (RenderAheadWork.next < RenderAheadWork.writes &&
+           RenderAheadWork.write[RenderAheadWork.next].time <= pos) {
+      RenderAheadApply(&RenderAheadWork.write[RenderAheadWork.next++]);
+    }
+    RenderAheadWork.buffer[pos % RenderAheadWork.capacity] =
+        SoundCortexUpdate();
+  }
+  if (limit > start)
+    RenderAheadWork.rendered = limit;
+  return RenderAheadWork.rendered - start;
+}
+
+uint32_t RenderAheadRead(uint16_t* output, uint32_t samples) {
+  uint32_t ready = RenderAheadWork.rendered - RenderAheadWork.cursor;
+  if (samples > ready)
+    samples = ready;
+  for (uint32_t i = 0; i < samples; ++i) {
+    output[i] = RenderAheadWork.buffer[
+        (RenderAheadWork.cursor + i) % RenderAheadWork.capacity];
+  }
+  RenderAheadWork.cursor += samples;
+
+  // Writes before the snapshot at or before the cursor are never replayed.
+  uint32_t base = RenderAheadWork.cursor / RenderAheadWork.interval *
+      RenderAheadWork.interval;
+  uint32_t done = RenderAheadFind(base);
+  if (done) {
+    for (uint32_t i = done; i < RenderAheadWork.writes; ++i)
+      RenderAheadWork.write[i - done] = RenderAheadWork.write[i];
+    RenderAheadWork.writes -= done;
+    RenderAheadWork.next -= done;
+  }
+  return samples;
+}
+
+bool RenderAheadWrite(uint32_t time, uint8_t chip, uint8_t reg, uint8_t value) {
+  if (RenderAheadWork.writes == RENDER_AHEAD_LOG) {
+    RenderAheadWork.stats.dropped++;
+    return false;
+  }
+  if (time < RenderAheadWork.cursor) {
+    time = RenderAheadWork.cursor;
+    RenderAheadWork.stats.late++;
+  }
+  // Writes at the same time keep their order.
+  uint32_t i = RenderAheadWork.writes++;
+  for (; i && RenderAheadWork.write[i - 1].time > time; --i)
+    RenderAheadWork.write[i] = RenderAheadWork.write[i - 1];
+  RenderAheadWork.write[i].time = time;
+  RenderAheadWork.write[i].chip = chip;
+  RenderAheadWork.write[i].reg = reg;
+  RenderAheadWork.write[i].value = value;
+  RenderAheadWork.stats.writes++;
+
+  if (time < RenderAheadWork.rendered) {
+    uint32_t start = time / RenderAheadWork.interval * RenderAheadWork.interval;
+    uint32_t resume =
+        start > RenderAheadWork.cursor ? start : RenderAheadWork.cursor;
+    RenderAheadWork.stats.rollbacks++;
+    RenderAheadWork.stats.rerendered += RenderAheadWork.rendered - resume;
+    SoundCortexLoad(RenderAheadSnapshot(start));
+    RenderAheadWork.next = RenderAheadFind(start);
+    RenderAheadAdvance(start, resume);
+    RenderAheadWork.rendered = resume;
+  }
+  return true;
+}
+
+void RenderAheadGetStats(RenderAheadStats* stats) {
+  *stats = RenderAheadWork.stats;
+}
+
+#endif  // defined(BUILD_RENDER_AHEAD)
@@ -27,14 +27,70 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
+// BuildConfig.h comes first, as SCC.h declares functions by build options.
+#include "BuildConfig.h"
 #include "SCC.h"
 
+#include <stddef.h>
+#include <string.h>
+
+#include "Counter.h"
+#include "Host.h"
+#include "MeterWork.h"
+#include "SCCWork.h"
+
 // Constant variables to improve readability.
 enum {
   CLK_MSX =  3579545UL,
   CLK_4MHZ = 4000000UL,
 };
 
+// Register writes only store raw values and raise flags. SCCFlush() derives
+// synthesizer parameters from them. Flags are per item bytes, and each
+// is cleared before the values it guards are read, so that bus interrupts
+// never race with clearing them. Wave tables are used as written,
+// and only interned at SCCFlush() for BUILD_SCC_INTERN.
+enum {
+  DIRTY_CH_1,
+  DIRTY_CH_2,
+  DIRTY_CH_3,
+  DIRTY_CH_4,
+  DIRTY_CH_5,
+  DIRTY_MIXER,
+#if defined(BUILD_SCC_INTERN)
+  DIRTY_WAVE,
+#endif
+  DIRTY_ANY,
+  DIRTY_SIZE,
+};
+
+#if defined(BUILD_PACKED)
+typedef struct {
+  uint32_t limit;
+  uint32_t count;
+  uint16_t tp;
+  uint8_t offset;
+  uint8_t vol;
+  uint8_t tone;
+  uint8_t ml;
+#if defined(BUILD_SCC_INTERN)
+  uint16_t wt;
+#else
+  uint8_t wt[32];
+#endif
+} Synth;
+
+HOST_LOCAL struct {
+  uint32_t step;
+  Synth synth[5];
+
+  uint32_t fout;
+  uint8_t mixer;
+  uint8_t dirty[DIRTY_SIZE];
+} SCCWork;
+
+#  define CHANNEL(ch) SCCWork.synth[ch]
+#else
 typedef struct {
   uint32_t tp;
   uint32_t ml;
@@ -46,17 +102,346 @@ typedef struct {
   uint32_t offset;
   uint32_t vol;
   uint32_t tone;
+#if defined(BUILD_SCC_INTERN)
+  uint16_t wt;
+#else
   uint8_t wt[32];
+#endif
 } Synth;
 
-struct {
+HOST_LOCAL struct {
   uint32_t step;
   Synth synth[5];
 
   uint32_t fout;
   Channel channel[5];
+  uint8_t mixer;
+  uint8_t dirty[DIRTY_SIZE];
 } SCCWork;
 
+#  define CHANNEL(ch) SCCWork.channel[ch]
+#endif
+
+// Keep SCCWork.h in sync with the structures above.
+_Static_assert(offsetof(Synth, limit) == iSCCSynthLimit, "iSCCSynthLimit");
+_Static_assert(offsetof(Synth, count) == iSCCSynthCount, "iSCCSynthCount");
+_Static_assert(offsetof(Synth, offset) == iSCCSynthOffset, "iSCCSynthOffset");
+_Static_assert(offsetof(Synth, vol) == iSCCSynthVol, "iSCCSynthVol");
+_Static_assert(offsetof(Synth, tone) == iSCCSynthTone, "iSCCSynthTone");
+_Static_assert(offsetof(Synth, wt) == iSCCSynthWaveTable, "iSCCSynthWaveTable");
+_Static_assert(sizeof(Synth) == iSCCSynthSize, "iSCCSynthSize");
+_Static_assert(offsetof(__typeof__(SCCWork), step) == iSCCStep, "iSCCStep");
+_Static_assert(offsetof(__typeof__(SCCWork), synth) == iSCCSynth, "iSCCSynth");
+_Static_assert(offsetof(__typeof__(SCCWork), fout) == iSCCFout, "iSCCFout");
+_Static_assert(sizeof(SCCWork) == iSCCWorkSize, "iSCCWorkSize");
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#pragma message("SCCWork: " XSTR(iSCCWorkSize) " bytes")
+
+#if defined(BUILD_SCC_INTERN)
+// Wave tables shared by all instances, e.g. threads of BUILD_HOST. Interned
+// tables are immutable, and found by their contents through hash buckets. A
+// voice that writes into a shared table gets a private copy, and SCCFlush()
+// interns it again. Slot 0 is the silent table. SCC_INTERN_LOCK() and
+// SCC_INTERN_UNLOCK() should exclude other instances, and bus interrupts that
+// call SCCWrite(). By default, they mask interrupts on the device, and spin on
+// a flag on hosts.
+//
+// Every slot in use is referred to by a voice, so an instance never needs
+// more than 5 slots besides the silent one. The device runs one instance
+// within SCCWaveTables, and hosts add chunks of SCC_INTERN_SIZE slots for
+// more instances. Chunks are never freed, so that voices on other threads
+// can read their tables without the lock.
+#if !defined(SCC_INTERN_SIZE)
+#  define SCC_INTERN_SIZE 64
+#endif
+#if !defined(SCC_INTERN_BUCKETS)
+#  define SCC_INTERN_BUCKETS 64
+#endif
+_Static_assert(SCC_INTERN_SIZE >= 6 && SCC_INTERN_SIZE < 0xffff,
+               "SCC_INTERN_SIZE should fit the silent table and 5 voices");
+_Static_assert(!(SCC_INTERN_BUCKETS & (SCC_INTERN_BUCKETS - 1)),
+               "SCC_INTERN_BUCKETS should be a power of 2");
+
+#if !defined(SCC_INTERN_LOCK)
+#  if defined(BUILD_HOST)
+#    include <sched.h>
+#    include <stdatomic.h>
+static atomic_flag SCCInternFlag = ATOMIC_FLAG_INIT;
+
+static void SCCInternLock() {
+  while (atomic_flag_test_and_set_explicit(&SCCInternFlag,
+                                           memory_order_acquire)) {
+    sched_yield();
+  }
+}
+
+static void SCCInternUnlock() {
+  atomic_flag_clear_explicit(&SCCInternFlag, memory_order_release);
+}
+#  else
+// Interrupts stay masked while the lock is held, so one saved mask is enough.
+static uint32_t SCCInternMask;
+
+static void SCCInternLock() {
+  uint32_t mask;
+  __asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r"(mask) :: "memory");
+  SCCInternMask = mask;
+}
+
+static void SCCInternUnlock() {
+  __asm__ volatile("msr primask, %0" :: "r"(SCCInternMask) : "memory");
+}
+#  endif
+#  define SCC_INTERN_LOCK() SCCInternLock()
+#  define SCC_INTERN_UNLOCK() SCCInternUnlock()
+#endif
+
+enum {
+  WAVE_NONE = 0xffff,
+};
+
+// |next| links interned tables in a bucket, or free slots.
+typedef struct {
+  uint32_t hash;
+  uint32_t refs;
+  uint16_t next;
+  bool interned;
+} WaveInfo;
+
+uint8_t SCCWaveTables[SCC_INTERN_SIZE][32];
+static WaveInfo SCCWaveInfo[SCC_INTERN_SIZE];
+
+#if defined(BUILD_HOST)
+#  include <stdlib.h>
+_Static_assert(!(SCC_INTERN_SIZE & (SCC_INTERN_SIZE - 1)),
+               "SCC_INTERN_SIZE should be a power of 2 on hosts");
+
+enum {
+  WAVE_CHUNKS = WAVE_NONE / SCC_INTERN_SIZE,
+};
+
+static uint8_t (*SCCWaveTableChunk[WAVE_CHUNKS])[32] = { SCCWaveTables };
+static WaveInfo* SCCWaveInfoChunk[WAVE_CHUNKS] = { SCCWaveInfo };
+static uint32_t SCCWaveChunks;
+
+#  define WAVE_TABLE(index) \
+      SCCWaveTableChunk[(index) / SCC_INTERN_SIZE][(index) % SCC_INTERN_SIZE]
+#  define WAVE_INFO(index) \
+      SCCWaveInfoChunk[(index) / SCC_INTERN_SIZE][(index) % SCC_INTERN_SIZE]
+#else
+#  define WAVE_TABLE(index) SCCWaveTables[index]
+#  define WAVE_INFO(index) SCCWaveInfo[index]
+#endif
+
+static uint16_t SCCWaveBucket[SCC_INTERN_BUCKETS];
+static uint16_t SCCWaveFree;
+static bool SCCWaveReady;
+
+// Voices of this instance that own a private table until SCCFlush(). Only
+// they write into it, so that further writes need no lock.
+static HOST_LOCAL uint8_t SCCWavePrivate;
+
+// Tables this instance could not get a slot for.
+static HOST_LOCAL uint32_t SCCWaveMisses;
+
+// Shared by all instances, and counted once.
+_Static_assert(sizeof(SCCWaveTables) + sizeof(SCCWaveInfo) ==
+               SCC_INTERN_SIZE * 44, "SCCWaveInfo");
+#pragma message("SCCWaveTables: " XSTR(SCC_INTERN_SIZE) " x 44 bytes")
+#pragma message("SCCWaveBucket: " XSTR(SCC_INTERN_BUCKETS) " x 2 bytes")
+
+#  define WAVE(synth) WAVE_TABLE((synth)->wt)
+
+static uint32_t SCCWaveHash(const uint8_t* wt) {
+  uint32_t hash = 2166136261UL;  // FNV-1a
+  for (int i = 0; i < 32; ++i) {
+    hash ^= wt[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+static void SCCWaveInsert(uint16_t index, uint32_t hash) {
+  uint16_t* bucket = &SCCWaveBucket[hash & (SCC_INTERN_BUCKETS - 1)];
+  WAVE_INFO(index).hash = hash;
+  WAVE_INFO(index).interned = true;
+  WAVE_INFO(index).next = *bucket;
+  *bucket = index;
+}
+
+// Takes an interned table out of its bucket so that it can be modified.
+static void SCCWaveRemove(uint16_t index) {
+  if (!WAVE_INFO(index).interned)
+    return;
+  uint16_t* link =
+      &SCCWaveBucket[WAVE_INFO(index).hash & (SCC_INTERN_BUCKETS - 1)];
+  while (*link != index)
+    link = &WAVE_INFO(*link).next;
+  *link = WAVE_INFO(index).next;
+  WAVE_INFO(index).interned = false;
+}
+
+// Links slots from |first| up to |end| into the free list.
+static void SCCWaveFreeSlots(uint32_t first, uint32_t end) {
+  for (uint32_t i = end; i > first; --i) {
+    WAVE_INFO(i - 1).next = SCCWaveFree;
+    SCCWaveFree = i - 1;
+  }
+}
+
+static void SCCWaveSetUp() {
+  if (SCCWaveReady)
+    return;
+  for (uint32_t i = 0; i < SCC_INTERN_BUCKETS; ++i)
+    SCCWaveBucket[i] = WAVE_NONE;
+  SCCWaveFree = WAVE_NONE;
+  SCCWaveFreeSlots(1, SCC_INTERN_SIZE);
+  SCCWaveInsert(0, SCCWaveHash(SCCWaveTables[0]));
+#if defined(BUILD_HOST)
+  SCCWaveChunks = 1;
+#endif
+  SCCWaveReady = true;
+}
+
+#if defined(BUILD_HOST)
+static bool SCCWaveGrow() {
+  if (SCCWaveChunks == WAVE_CHUNKS)
+    return false;
+  uint8_t (*tables)[32] = malloc(SCC_INTERN_SIZE * 32);
+  WaveInfo* info = malloc(SCC_INTERN_SIZE * sizeof(WaveInfo));
+  if (!tables || !info) {
+    free(tables);
+    free(info);
+    return false;
+  }
+  uint32_t first = SCCWaveChunks * SCC_INTERN_SIZE;
+  SCCWaveTableChunk[SCCWaveChunks] = tables;
+  SCCWaveInfoChunk[SCCWaveChunks] = info;
+  SCCWaveChunks++;
+  SCCWaveFreeSlots(first, first + SCC_INTERN_SIZE);
+  return true;
+}
+#else
+static bool SCCWaveGrow() {
+  return false;
+}
+#endif
+
+// Returns an interned table that has |wt| contents, or WAVE_NONE.
+static uint16_t SCCWaveFind(const uint8_t* wt, uint32_t hash) {
+  uint16_t i = SCCWaveBucket[hash & (SCC_INTERN_BUCKETS - 1)];
+  for (; i != WAVE_NONE; i = WAVE_INFO(i).next) {
+    if (WAVE_INFO(i).hash == hash && !memcmp(WAVE_TABLE(i), wt, 32))
+      return i;
+  }
+  return WAVE_NONE;
+}
+
+// Returns a free slot with a reference, or 0 if a host runs out of memory.
+static uint16_t SCCWaveAlloc() {
+  if (SCCWaveFree == WAVE_NONE && !SCCWaveGrow()) {
+    SCCWaveMisses++;
+    return 0;
+  }
+  uint16_t index = SCCWaveFree;
+  SCCWaveFree = WAVE_INFO(index).next;
+  WAVE_INFO(index).refs = 1;
+  return index;
+}
+
+static void SCCWaveRelease(uint16_t index) {
+  if (!index || --WAVE_INFO(index).refs)
+    return;
+  SCCWaveRemove(index);
+  WAVE_INFO(index).next = SCCWaveFree;
+  SCCWaveFree = index;
+}
+
+// Returns a referenced table that has |wt| contents.
+static uint16_t SCCWaveAcquire(const uint8_t* wt) {
+  uint32_t hash = SCCWaveHash(wt);
+  uint16_t index = SCCWaveFind(wt, hash);
+  if (index != WAVE_NONE) {
+    if (index)
+      WAVE_INFO(index).refs++;
+    return index;
+  }
+  index = SCCWaveAlloc();
+  if (index) {
+    memcpy(WAVE_TABLE(index), wt, 32);
+    SCCWaveInsert(index, hash);
+  }
+  return index;
+}
+
+// Makes the table of |ch| private, and returns false if no slot is left.
+static bool SCCWaveOwn(int ch) {
+  uint16_t index = SCCWork.synth[ch].wt;
+  if (!index || WAVE_INFO(index).refs > 1) {
+    uint16_t copy = SCCWaveAlloc();
+    if (!copy)
+      return false;
+    memcpy(WAVE_TABLE(copy), WAVE_TABLE(index), 32);
+    SCCWaveRelease(index);
+    SCCWork.synth[ch].wt = copy;
+  } else {
+    SCCWaveRemove(index);
+  }
+  SCCWavePrivate |= 1 << ch;
+  return true;
+}
+
+static bool SCCWaveWrite(int ch, int offset, uint8_t value) {
+  if (!(SCCWavePrivate & (1 << ch))) {
+    if (WAVE(&SCCWork.synth[ch])[offset] == value)
+      return true;
+    SCC_INTERN_LOCK();
+    bool owned = SCCWaveOwn(ch);
+    SCC_INTERN_UNLOCK();
+    if (!owned)
+      return false;
+  }
+  WAVE(&SCCWork.synth[ch])[offset] = value;
+  SCCWork.dirty[DIRTY_WAVE] = 1;
+  SCCWork.dirty[DIRTY_ANY] = 1;
+  return true;
+}
+
+static void SCCWaveIntern(int ch) {
+  uint16_t index = SCCWork.synth[ch].wt;
+  if (WAVE_INFO(index).interned)
+    return;
+  uint32_t hash = SCCWaveHash(WAVE_TABLE(index));
+  uint16_t found = SCCWaveFind(WAVE_TABLE(index), hash);
+  if (found == WAVE_NONE) {
+    SCCWaveInsert(index, hash);
+    return;
+  }
+  SCCWaveRelease(index);
+  if (found)
+    WAVE_INFO(found).refs++;
+  SCCWork.synth[ch].wt = found;
+}
+
+void SCCRelease() {
+  SCC_INTERN_LOCK();
+  for (int ch = 0; ch < 5; ++ch) {
+    SCCWaveRelease(SCCWork.synth[ch].wt);
+    SCCWork.synth[ch].wt = 0;
+  }
+  SCCWavePrivate = 0;
+  SCC_INTERN_UNLOCK();
+}
+
+uint32_t SCCGetWaveMisses() {
+  return SCCWaveMisses;
+}
+#else
+#  define WAVE(synth) (synth)->wt
+#endif
+
 void SCCInit(uint32_t sample_rate) {
   SCCWork.step = CLK_MSX;
   SCCWork.fout = sample_rate;
@@ -66,9 +451,35 @@ void SCCInit(uint32_t sample_rate) {
     SCCWork.synth[i].offset = 0;
     SCCWork.synth[i].vol = 0;
     SCCWork.synth[i].tone = 1;
+#if defined(BUILD_SCC_INTERN)
+    SCC_INTERN_LOCK();
+    SCCWaveSetUp();
+    SCCWaveRelease(SCCWork.synth[i].wt);
+    SCCWork.synth[i].wt = 0;
+    SCC_INTERN_UNLOCK();
+#else
     for (int j = 0; j < 32; ++j)
       SCCWork.synth[i].wt[j] = 0;
+#endif
   }
+  for (int i = 0; i < DIRTY_SIZE; ++i)
+    SCCWork.dirty[i] = 0;
+#if defined(BUILD_SCC_INTERN)
+  SCCWavePrivate = 0;
+  SCCWaveMisses = 0;
+#endif
+}
+
+static void SCCMarkDirty(int index) {
+  SCCWork.dirty[index] = 1;
+  SCCWork.dirty[DIRTY_ANY] = 1;
+}
+
+// The barrier keeps the clear before loads of the values that the flag
+// guards, so that a write landing in between raises the flag again.
+static void SCCClearDirty(int index) {
+  SCCWork.dirty[index] = 0;
+  __asm__ volatile("" ::: "memory");
 }
 
 bool SCCWrite(uint8_t reg, uint8_t value) {
@@ -76,24 +487,25 @@ bool SCCWrite(uint8_t reg, uint8_t value) {
   if (reg <= 0x9f) {
     int ch = reg >> 5;
     int offset = reg & 0x1f;
+#if defined(BUILD_SCC_INTERN)
+    return SCCWaveWrite(ch, offset, value);
+#else
     SCCWork.synth[ch].wt[offset] = value;
+#endif
   } else if (reg <= 0xa9) {
     int ch = (reg - 0xa0) >> 1;
     if (reg & 1)
-      SCCWork.channel[ch].tp = (SCCWork.channel[ch].tp & 0x00ff) | ((uint16_t)(value & 0x0f) << 8);
+      CHANNEL(ch).tp = (CHANNEL(ch).tp & 0x00ff) | ((uint16_t)(value & 0x0f) << 8);
     else
-      SCCWork.channel[ch].tp = (SCCWork.channel[ch].tp & 0x0f00) | value;
-    SCCWork.synth[ch].limit = (uint32_t)SCCWork.channel[ch].tp * SCCWork.fout;
+      CHANNEL(ch).tp = (CHANNEL(ch).tp & 0x0f00) | value;
+    SCCMarkDirty(DIRTY_CH_1 + ch);
   } else if (reg <= 0xae) {
     int ch = reg - 0xaa;
-    SCCWork.channel[ch].ml = value & 0x0f;
-    SCCWork.synth[ch].vol = SCCWork.channel[ch].ml;
+    CHANNEL(ch).ml = value & 0x0f;
+    SCCMarkDirty(DIRTY_CH_1 + ch);
   } else if (reg == 0xaf) {
-    SCCWork.synth[0].tone = value & (1 << 0);
-    SCCWork.synth[1].tone = value & (1 << 1);
-    SCCWork.synth[2].tone = value & (1 << 2);
-    SCCWork.synth[3].tone = value & (1 << 3);
-    SCCWork.synth[4].tone = value & (1 << 4);
+    SCCWork.mixer = value;
+    SCCMarkDirty(DIRTY_MIXER);
   } else if (reg == 0xff) {
     // Virtual Clock
     if (value == 0)
@@ -105,8 +517,135 @@ bool SCCWrite(uint8_t reg, uint8_t value) {
   return true;
 }
 
+bool SCCFlush() {
+  if (!SCCWork.dirty[DIRTY_ANY])
+    return false;
+  SCCClearDirty(DIRTY_ANY);
+  for (int ch = 0; ch < 5; ++ch) {
+    if (!SCCWork.dirty[DIRTY_CH_1 + ch])
+      continue;
+    SCCClearDirty(DIRTY_CH_1 + ch);
+    SCCWork.synth[ch].limit = (uint32_t)CHANNEL(ch).tp * SCCWork.fout;
+    SCCWork.synth[ch].vol = CHANNEL(ch).ml;
+  }
+  if (SCCWork.dirty[DIRTY_MIXER]) {
+    SCCClearDirty(DIRTY_MIXER);
+    uint8_t value = SCCWork.mixer;
+    SCCWork.synth[0].tone = value & (1 << 0);
+    SCCWork.synth[1].tone = value & (1 << 1);
+    SCCWork.synth[2].tone = value & (1 << 2);
+    SCCWork.synth[3].tone = value & (1 << 3);
+    SCCWork.synth[4].tone = value & (1 << 4);
+  }
+#if defined(BUILD_SCC_INTERN)
+  if (SCCWork.dirty[DIRTY_WAVE]) {
+    SCCClearDirty(DIRTY_WAVE);
+    SCC_INTERN_LOCK();
+    for (int ch = 0; ch < 5; ++ch)
+      SCCWaveIntern(ch);
+    SCCWavePrivate = 0;
+    SCC_INTERN_UNLOCK();
+  }
+#endif
+  return true;
+}
+
+#if defined(BUILD_HOST)
+// C version of SCCUpdate.S. Results should be identical.
+int16_t SCCUpdate() {
+  uint32_t step = SCCWork.step;
+  int32_t out = 0;
+  for (int ch = 0; ch < 5; ++ch) {
+    Synth* synth = &SCCWork.synth[ch];
+    uint32_t count = synth->count + step;
+    synth->count = count;
+    if (count <= synth->limit) {
+      synth->count = count - synth->limit;
+      synth->offset = (synth->offset + 1) & 0x1f;
+    }
+    if (synth->tone)
+      out += (int8_t)WAVE(synth)[synth->offset] * (int32_t)synth->vol;
+  }
+  return out >> 4;
+}
+#endif
+
+bool SCCIsDirty() {
+  return SCCWork.dirty[DIRTY_ANY];
+}
+
+bool SCCIsDeferred(uint8_t reg) {
+  // Wave tables are used as written. BUILD_SCC_INTERN flushes them too, but
+  // only to share the contents.
+  return reg >= 0xa0 && reg <= 0xaf;
+}
+
+void SCCSkip(uint32_t samples) {
+  uint32_t step = SCCWork.step;
+  for (int ch = 0; ch < 5; ++ch) {
+    Synth* synth = &SCCWork.synth[ch];
+    uint32_t steps = CounterSkip(&synth->count, synth->limit, step, samples);
+    synth->offset = (synth->offset + steps) & 0x1f;
+  }
+}
+
+void SCCResetPhase() {
+  for (int ch = 0; ch < 5; ++ch) {
+    SCCWork.synth[ch].count = 0;
+    SCCWork.synth[ch].offset = 0;
+  }
+}
+
+#if defined(BUILD_METER)
+// Voice levels are magnitudes of the wave sample times the volume, before
+// SCCUpdate() scales the sum down, and take 1920 at most. |level| keeps the
+// last latched levels for bus reads.
+HOST_LOCAL struct {
+  MeterSum sum[5];
+  MeterLevel level[5];
+} SCCMeterWork;
+
+#define iSCCMeterWorkSize 120
+_Static_assert(sizeof(SCCMeterWork) == iSCCMeterWorkSize, "iSCCMeterWorkSize");
+#pragma message("SCCMeterWork: " XSTR(iSCCMeterWorkSize) " bytes")
+
+void SCCMeter() {
+  for (int ch = 0; ch < 5; ++ch) {
+    Synth* synth = &SCCWork.synth[ch];
+    int32_t level = 0;
+    if (synth->tone)
+      level = (int8_t)WAVE(synth)[synth->offset] * (int32_t)synth->vol;
+    MeterAdd(&SCCMeterWork.sum[ch], level < 0 ? -level : level);
+  }
+}
+
+void SCCLatchMeters(MeterLevel* levels) {
+  for (int ch = 0; ch < 5; ++ch) {
+    MeterLatch(&SCCMeterWork.sum[ch], &SCCMeterWork.level[ch],
+               METER_WINDOW_SHIFT);
+    levels[ch] = SCCMeterWork.level[ch];
+  }
+}
+#endif
+
 bool SCCRead(uint8_t reg, uint8_t* value) {
   switch (reg) {
+#if defined(BUILD_METER)
+  case 0xe0:  // Ch.1 peak
+  case 0xe1:  // Ch.2 peak
+  case 0xe2:  // Ch.3 peak
+  case 0xe3:  // Ch.4 peak
+  case 0xe4:  // Ch.5 peak
+    *value = SCCMeterWork.level[reg - 0xe0].peak >> 3;
+    break;
+  case 0xe8:  // Ch.1 RMS
+  case 0xe9:  // Ch.2 RMS
+  case 0xea:  // Ch.3 RMS
+  case 0xeb:  // Ch.4 RMS
+  case 0xec:  // Ch.5 RMS
+    *value = SCCMeterWork.level[reg - 0xe8].rms >> 3;
+    break;
+#endif
   case 0xfe:  // minor version
     *value = 1;
     break;
@@ -118,3 +657,39 @@ bool SCCRead(uint8_t reg, uint8_t* value) {
   }
   return true;
 }
+
+uint32_t SCCStateSize() {
+#if defined(BUILD_SCC_INTERN)
+  return sizeof(SCCWork) + 5 * 32;
+#else
+  return sizeof(SCCWork);
+#endif
+}
+
+void SCCSave(uint8_t* state) {
+  memcpy(state, &SCCWork, sizeof(SCCWork));
+#if defined(BUILD_SCC_INTERN)
+  // Tables are saved by contents, as indices are only valid in this process.
+  uint8_t* tables = &state[sizeof(SCCWork)];
+  for (int ch = 0; ch < 5; ++ch) {
+    memcpy(&tables[ch * 32], WAVE(&SCCWork.synth[ch]), 32);
+    memset(&state[iSCCSynth + iSCCSynthSize * ch + iSCCSynthWaveTable], 0, 2);
+  }
+#endif
+}
+
+void SCCLoad(const uint8_t* state) {
+#if defined(BUILD_SCC_INTERN)
+  SCC_INTERN_LOCK();
+  for (int ch = 0; ch < 5; ++ch)
+    SCCWaveRelease(SCCWork.synth[ch].wt);
+  memcpy(&SCCWork, state, sizeof(SCCWork));
+  const uint8_t* tables = &state[sizeof(SCCWork)];
+  for (int ch = 0; ch < 5; ++ch)
+    SCCWork.synth[ch].wt = SCCWaveAcquire(&tables[ch * 32]);
+  SCCWavePrivate = 0;
+  SCC_INTERN_UNLOCK();
+#else
+  memcpy(&SCCWork, state, sizeof(SCCWork));
+#endif
+}
@@ -0,0 +1,149 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#ifndef __SCCWork_h__
+#define __SCCWork_h__
+
+// Memory layout of SCCWork shared by SCC.c and the assembly kernels.
+// BUILD_PACKED selects narrower fields for small RAM parts, and merges
+// per-channel register values into Synth. BUILD_SCC_INTERN replaces each wave
+// table with an index into SCCWaveTables shared by all instances.
+
+#define iSCCStep 0
+#define iSCCSynth 4
+
+#if defined(BUILD_PACKED)
+
+#define iSCCSynthLimit 0
+#define iSCCSynthCount 4
+#define iSCCSynthTp 8
+#define iSCCSynthOffset 10
+#define iSCCSynthVol 11
+#define iSCCSynthTone 12
+#define iSCCSynthMl 13
+#define iSCCSynthWaveTable 14
+#if defined(BUILD_SCC_INTERN)
+#define iSCCSynthSize 16
+#define iSCCWorkSize 100
+#else
+#define iSCCSynthSize 48
+#define iSCCWorkSize 256
+#endif
+
+#if defined(__ASSEMBLER__)
+#define ldrSCCOffset ldrb
+#define strSCCOffset strb
+#define ldrSCCVol ldrb
+#define ldrSCCTone ldrb
+#endif
+
+#else  // !defined(BUILD_PACKED)
+
+#define iSCCSynthLimit 0
+#define iSCCSynthCount 4
+#define iSCCSynthOffset 8
+#define iSCCSynthVol 12
+#define iSCCSynthTone 16
+#define iSCCSynthWaveTable 20
+#if defined(BUILD_SCC_INTERN)
+#define iSCCSynthSize 24
+#define iSCCWorkSize 180
+#else
+#define iSCCSynthSize 52
+#define iSCCWorkSize 316
+#endif
+
+#if defined(__ASSEMBLER__)
+#define ldrSCCOffset ldr
+#define strSCCOffset str
+#define ldrSCCVol ldr
+#define ldrSCCTone ldr
+#endif
+
+#endif  // defined(BUILD_PACKED)
+
+#define iSCCFout (iSCCSynth + iSCCSynthSize * 5)
+
+#if defined(__ASSEMBLER__)
+// Kernel building blocks. Includers define rOut, rWork, rStep, rMask,
+// rTableOffset, and rTmp1-3 before including this file. rWork should point
+// SCCWork, and rOut accumulates the output. SCCUpdateTones moves rWork.
+// rTableOffset holds SCCWaveTables instead for BUILD_SCC_INTERN.
+
+.macro SCCUpdateTone
+  ldr  rTmp1, [rWork, #(iSCCSynth + iSCCSynthCount)]
+  add  rTmp1, rTmp1, rStep
+  str  rTmp1, [rWork, #(iSCCSynth + iSCCSynthCount)]
+  ldr  rTmp2, [rWork, #(iSCCSynth + iSCCSynthLimit)]
+  subs rTmp3, rTmp1, rTmp2
+  ldrSCCOffset rTmp1, [rWork, #(iSCCSynth + iSCCSynthOffset)]
+  bhi  1f
+  str  rTmp3, [rWork, #(iSCCSynth + iSCCSynthCount)]
+  adds rTmp1, rTmp1, #1
+  ands rTmp1, rTmp1, rMask
+  strSCCOffset rTmp1, [rWork, #(iSCCSynth + iSCCSynthOffset)]
+1:
+  ldrSCCTone rTmp2, [rWork, #(iSCCSynth + iSCCSynthTone)]
+  orrs rTmp2, rTmp2, rTmp2
+  beq  1f
+#if defined(BUILD_SCC_INTERN)
+  ldrh rTmp2, [rWork, #(iSCCSynth + iSCCSynthWaveTable)]
+  lsls rTmp2, rTmp2, #5
+  add  rTmp1, rTmp1, rTmp2
+#else
+  add  rTmp1, rTmp1, rWork
+#endif
+  ldrsb rTmp1, [rTmp1, rTableOffset]
+  ldrSCCVol rTmp2, [rWork, #(iSCCSynth + iSCCSynthVol)]
+  muls rTmp1, rTmp1, rTmp2
+  add  rOut, rOut, rTmp1
+1:
+.endm
+
+.macro SCCUpdateTones
+  movs rMask, #0x1f
+#if defined(BUILD_SCC_INTERN)
+  ldr  rTableOffset, =#SCCWaveTables
+#else
+  movs rTableOffset, #(iSCCSynth + iSCCSynthWaveTable)
+#endif
+
+  SCCUpdateTone
+  adds rWork, rWork, #iSCCSynthSize
+  SCCUpdateTone
+  adds rWork, rWork, #iSCCSynthSize
+  SCCUpdateTone
+  adds rWork, rWork, #iSCCSynthSize
+  SCCUpdateTone
+  adds rWork, rWork, #iSCCSynthSize
+  SCCUpdateTone
+.endm
+#endif  // defined(__ASSEMBLER__)
+
+#endif  // __SCCWork_h__
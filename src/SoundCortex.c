@@ -28,16 +28,69 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 //
 #include <stdbool.h>
+#include <string.h>
 
 #include "BuildConfig.h"
 #include "SoundCortex.h"
 
-uint16_t SoundCortexUpdate() {
-#if defined(BUILD_MIDI)
-  MIDIUpdate(21, true, 120);  // 21.3usec
+#if defined(BUILD_METER)
+#  include "Host.h"
+#  include "MeterWork.h"
+#endif
+
+#if defined(BUILD_TRACE)
+#  define TRACE(event, chip, reg, value) TraceRecord(event, chip, reg, value)
+#else
+#  define TRACE(event, chip, reg, value)
+#endif
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+
+enum {
+  APPLIED_PSG = 1 << 0,
+  APPLIED_SCC = 1 << 1,
+};
+
+static uint8_t SoundCortexFlush() {
+  uint8_t applied = 0;
+#if defined(BUILD_PSG)
+  if (PSGFlush()) {
+    TRACE(TRACE_APPLY, PSG_ADDRESS, 0, 0);
+    applied |= APPLIED_PSG;
+  }
+#endif
+#if defined(BUILD_SCC)
+  if (SCCFlush()) {
+    TRACE(TRACE_APPLY, SCC_ADDRESS, 0, 0);
+    applied |= APPLIED_SCC;
+  }
+#endif
+  return applied;
+}
+
+static void SoundCortexTraceRender(uint8_t applied) {
+#if defined(BUILD_TRACE) && defined(BUILD_PSG)
+  if (applied & APPLIED_PSG)
+    TraceRecord(TRACE_RENDER, PSG_ADDRESS, 0, 0);
+#endif
+#if defined(BUILD_TRACE) && defined(BUILD_SCC)
+  if (applied & APPLIED_SCC)
+    TraceRecord(TRACE_RENDER, SCC_ADDRESS, 0, 0);
+#endif
+}
+
+#if defined(BUILD_FUSED)
+// Implemented in PSGSCCUpdate.S.
+uint16_t PSGSCCUpdate();
+void PSGSCCUpdateBlock(uint16_t* buffer, uint32_t samples);
 #endif
+
+static uint16_t SoundCortexMix() {
   // TODO: Use signed signals for both.
-#if defined(BUILD_PSG) && !defined(BUILD_SCC)
+#if defined(BUILD_FUSED)
+  return PSGSCCUpdate();
+#elif defined(BUILD_PSG) && !defined(BUILD_SCC)
   return PSGUpdate();
 #elif !defined(BUILD_PSG) && defined(BUILD_SCC)
   return 320 + (SCCUpdate() >> 1);
@@ -48,6 +101,448 @@ uint16_t SoundCortexUpdate() {
 #endif
 }
 
+#if defined(BUILD_MIDI) || defined(BUILD_KEYFRAME) || \
+    defined(BUILD_LOOP_CACHE) || defined(BUILD_RENDER_AHEAD)
+static bool SoundCortexIsDirty() {
+  bool dirty = false;
+#if defined(BUILD_PSG)
+  dirty |= PSGIsDirty();
+#endif
+#if defined(BUILD_SCC)
+  dirty |= SCCIsDirty();
+#endif
+  return dirty;
+}
+#endif
+
+#if defined(BUILD_KEYFRAME) || defined(BUILD_LOOP_CACHE) || \
+    defined(BUILD_RENDER_AHEAD)
+static void SoundCortexSkip(uint32_t samples) {
+#if defined(BUILD_PSG)
+  PSGSkip(samples);
+#endif
+#if defined(BUILD_SCC)
+  SCCSkip(samples);
+#endif
+}
+#endif
+
+#if defined(BUILD_LOOP_CACHE)
+// The loop cache records one pass of the song with a hash of the state at the
+// loop point. If the next pass starts from the same state, the pass is known
+// to render the same samples, and they are streamed from the cache. Voices
+// keep advancing as PSGSkip() and SCCSkip() in bulk so that the state stays
+// exact, and the cache can stop at any sample. A hash match is confirmed
+// against the whole recorded state, so that a collision never streams a
+// wrong pass.
+#if !defined(BUILD_MIDI)
+#  error "BUILD_LOOP_CACHE finds loop points through BUILD_MIDI"
+#endif
+
+enum {
+  CACHE_OFF,
+  CACHE_RECORD,
+  CACHE_PLAY,
+};
+
+static struct {
+  uint8_t* state;    // state at the recorded loop point
+  uint8_t* scratch;  // state at the current loop point
+  uint16_t* pcm;
+  uint32_t capacity;
+  uint32_t size;
+  uint32_t pos;
+  uint32_t hash;
+  uint32_t loops;
+  uint32_t pending;  // samples that voices have not advanced yet
+  uint8_t mode;
+  volatile uint8_t written;
+} cache;
+
+// The cache holds pointers, and 64-bit hosts report their own size. The
+// buffer is given by the caller.
+#if __SIZEOF_POINTER__ == 4
+#  define iSoundCortexCacheSize 40
+#else
+#  define iSoundCortexCacheSize 56
+#endif
+_Static_assert(sizeof(cache) == iSoundCortexCacheSize, "iSoundCortexCacheSize");
+#pragma message("SoundCortex cache: " XSTR(iSoundCortexCacheSize) " bytes")
+
+static uint32_t SoundCortexHash(const uint8_t* state, uint32_t size) {
+  uint32_t hash = 2166136261UL;  // FNV-1a
+  for (uint32_t i = 0; i < size; ++i) {
+    hash ^= state[i];
+    hash *= 16777619UL;
+  }
+  return hash;
+}
+
+static void SoundCortexCatchUp() {
+  SoundCortexSkip(cache.pending);
+  cache.pending = 0;
+}
+
+static void SoundCortexLoopCacheStop() {
+  if (cache.mode == CACHE_PLAY)
+    SoundCortexCatchUp();
+  cache.mode = CACHE_OFF;
+}
+
+// Voices restart their phases at every loop point while the cache is enabled,
+// even where the song is advanced without the cache, so that the output does
+// not depend on the path.
+static bool SoundCortexLoopCacheLooped() {
+  uint32_t loops = MIDIGetLoops();
+  if (!cache.capacity || cache.loops == loops)
+    return false;
+  cache.loops = loops;
+#if defined(BUILD_PSG)
+  PSGResetPhase();
+#endif
+#if defined(BUILD_SCC)
+  SCCResetPhase();
+#endif
+  return true;
+}
+
+static void SoundCortexLoopCacheStart() {
+  cache.pending = 0;
+  bool complete = (cache.mode == CACHE_RECORD) ||
+      (cache.mode == CACHE_PLAY && cache.pos == cache.size);
+  uint32_t size = SoundCortexStateSize();
+  SoundCortexSave(cache.scratch);
+  uint32_t hash = SoundCortexHash(cache.scratch, size);
+  if (complete && cache.size && hash == cache.hash &&
+      !memcmp(cache.scratch, cache.state, size)) {
+    cache.mode = CACHE_PLAY;
+    cache.pos = 0;
+  } else {
+    cache.mode = CACHE_RECORD;
+    cache.size = 0;
+    cache.hash = hash;
+    uint8_t* state = cache.state;
+    cache.state = cache.scratch;
+    cache.scratch = state;
+  }
+}
+
+void SoundCortexLoopCacheInit(uint8_t* buffer, uint32_t size) {
+  uint32_t state_size = (SoundCortexStateSize() + 3) & ~3;
+  SoundCortexLoopCacheStop();
+  cache.capacity = 0;
+  if (size <= state_size * 2)
+    return;
+  cache.state = buffer;
+  cache.scratch = &buffer[state_size];
+  cache.pcm = (uint16_t*)&buffer[state_size * 2];
+  cache.capacity = (size - state_size * 2) >> 1;
+  cache.loops = MIDIGetLoops();
+  cache.written = 0;
+}
+
+// Returns true with a cached |sample| if the cache serves this sample.
+static bool SoundCortexLoopCachePlay(uint16_t* sample) {
+  if (!cache.capacity)
+    return false;
+  if (cache.written) {
+    cache.written = 0;
+    SoundCortexLoopCacheStop();
+  }
+  if (SoundCortexLoopCacheLooped())
+    SoundCortexLoopCacheStart();
+  if (cache.mode != CACHE_PLAY)
+    return false;
+  if (cache.pos == cache.size) {
+    SoundCortexLoopCacheStop();
+    return false;
+  }
+  if (SoundCortexIsDirty()) {
+    SoundCortexCatchUp();
+    SoundCortexFlush();
+  }
+  cache.pending++;
+  *sample = cache.pcm[cache.pos++];
+  return true;
+}
+
+static void SoundCortexLoopCacheRecord(uint16_t sample) {
+  if (cache.mode != CACHE_RECORD)
+    return;
+  if (cache.size == cache.capacity)
+    cache.mode = CACHE_OFF;  // The loop is too long to cache.
+  else
+    cache.pcm[cache.size++] = sample;
+}
+#endif
+
+#if defined(BUILD_ADAPTIVE_BLOCK)
+#if !defined(BLOCK_MIN)
+#  define BLOCK_MIN 8
+#endif
+#if !defined(BLOCK_MAX)
+#  define BLOCK_MAX 256
+#endif
+#if !defined(BLOCK_QUIET)
+#  define BLOCK_QUIET 4
+#endif
+#if !defined(BLOCK_AHEAD)
+#  define BLOCK_AHEAD 4
+#endif
+
+static struct {
+  volatile uint32_t writes;  // counted by bus interrupts
+  uint32_t seen;
+  uint32_t size;
+  uint32_t quiet;
+  SoundCortexBlockStats stats;
+} block = { .size = BLOCK_MAX };
+
+#define iSoundCortexBlockSize 36
+_Static_assert(sizeof(block) == iSoundCortexBlockSize, "iSoundCortexBlockSize");
+#pragma message("SoundCortex block: " XSTR(iSoundCortexBlockSize) " bytes")
+
+uint32_t SoundCortexNextBlockSize(uint32_t fill, uint32_t capacity) {
+  uint32_t writes = block.writes;
+  bool active = writes != block.seen;
+  block.stats.writes += writes - block.seen;
+  block.seen = writes;
+  // Writes are checked first, as a refill loop often starts with little left
+  // to play, and would never see them otherwise.
+  if (active) {
+    block.quiet = 0;
+    if (block.size > BLOCK_MIN) {
+      block.size >>= 1;
+      block.stats.shrinks++;
+    }
+  } else if (fill < block.size) {
+    // Less than one block is left to play. Larger blocks cost less per sample.
+    block.quiet = 0;
+    if (block.size < BLOCK_MAX) {
+      block.size <<= 1;
+      block.stats.starves++;
+    }
+  } else if (++block.quiet >= BLOCK_QUIET) {
+    block.quiet = 0;
+    if (block.size < BLOCK_MAX) {
+      block.size <<= 1;
+      block.stats.grows++;
+    }
+  }
+  // Small blocks also keep fewer samples queued, i.e. lower latency.
+  uint32_t limit = block.size * BLOCK_AHEAD;
+  if (limit > capacity)
+    limit = capacity;
+  if (fill >= limit)
+    return 0;
+  if (limit - fill < block.size) {
+    block.stats.clamps++;
+    return limit - fill;
+  }
+  return block.size;
+}
+
+void SoundCortexGetBlockStats(SoundCortexBlockStats* stats) {
+  *stats = block.stats;
+}
+#endif
+
+#if defined(BUILD_METER)
+// Peaks and clips of the mix are measured at every sample. RMS levels of the
+// mix and voices are sampled every 2^METER_STEP_SHIFT samples, and voices only
+// while they are actually rendered. Each board has one writer, so
+// the default one is HOST_LOCAL, and threads that share levels should set
+// their own.
+static HOST_LOCAL SoundCortexMeterBoard default_board;
+
+static HOST_LOCAL struct {
+  MeterSum sum;
+  uint32_t samples;
+  MeterLevel mix;
+  SoundCortexMeterBoard* board;
+} meter;
+
+#if __SIZEOF_POINTER__ == 4
+#  define iSoundCortexMeterSize 32
+#else
+#  define iSoundCortexMeterSize 40
+#endif
+#if defined(BUILD_PSG) && defined(BUILD_SCC)
+#  define iSoundCortexMeterBoardSize 76
+#elif defined(BUILD_SCC)
+#  define iSoundCortexMeterBoardSize 52
+#elif defined(BUILD_PSG)
+#  define iSoundCortexMeterBoardSize 36
+#else
+#  define iSoundCortexMeterBoardSize 12
+#endif
+_Static_assert(sizeof(meter) == iSoundCortexMeterSize, "iSoundCortexMeterSize");
+_Static_assert(sizeof(default_board) == iSoundCortexMeterBoardSize,
+               "iSoundCortexMeterBoardSize");
+#pragma message("SoundCortex meter: " XSTR(iSoundCortexMeterSize) " bytes")
+#pragma message("SoundCortexMeterBoard: " XSTR(iSoundCortexMeterBoardSize) \
+                " bytes")
+
+static void SoundCortexMeterStep(uint16_t sample, bool voices) {
+  MeterAdd(&meter.sum, sample);
+  if (voices) {
+#if defined(BUILD_PSG)
+    PSGMeter();
+#endif
+#if defined(BUILD_SCC)
+    SCCMeter();
+#endif
+  }
+  if (meter.samples & ((1 << (METER_STEP_SHIFT + METER_WINDOW_SHIFT)) - 1))
+    return;
+  SoundCortexMeterBoard* target = meter.board ? meter.board : &default_board;
+  MeterBeginPublish(&target->sequence);
+#if defined(BUILD_PSG)
+  PSGLatchMeters(target->meters.psg);
+#endif
+#if defined(BUILD_SCC)
+  SCCLatchMeters(target->meters.scc);
+#endif
+  MeterLatch(&meter.sum, &meter.mix, METER_WINDOW_SHIFT);
+  target->meters.mix = meter.mix;
+  MeterEndPublish(&target->sequence);
+}
+
+// Kept small so that it is inlined into the render loops.
+static inline void SoundCortexMeter(uint16_t sample, bool voices) {
+  if (sample > meter.sum.peak)
+    meter.sum.peak = sample;
+  if (sample > METER_CLIP)
+    meter.mix.clips++;
+  if (!(++meter.samples & ((1 << METER_STEP_SHIFT) - 1)))
+    SoundCortexMeterStep(sample, voices);
+}
+
+void SoundCortexSetMeterBoard(SoundCortexMeterBoard* board) {
+  meter.board = board;
+}
+
+void SoundCortexGetMeters(const SoundCortexMeterBoard* board,
+                          SoundCortexMeters* meters) {
+  const SoundCortexMeterBoard* source = board ? board : &default_board;
+  MeterCopy(&source->sequence, meters, &source->meters, sizeof(*meters));
+}
+#endif
+
+#if defined(BUILD_I2C) || defined(BUILD_SPI) || defined(BUILD_IOEXT)
+#if defined(BUILD_TRACE)
+static bool SoundCortexIsDeferred(uint8_t chip, uint8_t reg) {
+#if defined(BUILD_PSG) && !defined(BUILD_SCC)
+  return PSGIsDeferred(reg);
+#elif !defined(BUILD_PSG) && defined(BUILD_SCC)
+  return SCCIsDeferred(reg);
+#elif defined(BUILD_PSG) && defined(BUILD_SCC)
+  if (chip == PSG_ADDRESS)
+    return PSGIsDeferred(reg);
+  return SCCIsDeferred(reg);
+#else
+  return false;
+#endif
+}
+#endif
+
+static void SoundCortexBusWrite(uint8_t chip, uint8_t reg, uint8_t value) {
+#if defined(BUILD_TRACE)
+  // Other writes are never followed by TRACE_APPLY, and would be charged the
+  // latency of the next unrelated flush.
+  if (SoundCortexIsDeferred(chip, reg))
+    TRACE(TRACE_BUS_WRITE, chip, reg, value);
+#endif
+#if defined(BUILD_LOOP_CACHE)
+  cache.written = 1;
+#endif
+#if defined(BUILD_ADAPTIVE_BLOCK)
+  block.writes++;
+#endif
+}
+#endif
+
+uint16_t SoundCortexUpdate() {
+#if defined(BUILD_MIDI)
+  MIDIUpdate(21, true, 120);  // 21.3usec
+#endif
+#if defined(BUILD_LOOP_CACHE)
+  uint16_t cached;
+  if (SoundCortexLoopCachePlay(&cached)) {
+#if defined(BUILD_METER)
+    SoundCortexMeter(cached, false);
+#endif
+    return cached;
+  }
+#endif
+  uint8_t applied = SoundCortexFlush();
+  uint16_t sample = SoundCortexMix();
+  SoundCortexTraceRender(applied);
+#if defined(BUILD_METER)
+  SoundCortexMeter(sample, true);
+#endif
+#if defined(BUILD_LOOP_CACHE)
+  SoundCortexLoopCacheRecord(sample);
+#endif
+  return sample;
+}
+
+// Renders |samples| samples in the current state.
+static void SoundCortexRender(uint16_t* buffer, uint32_t samples,
+                              uint8_t applied) {
+#if defined(BUILD_FUSED)
+  PSGSCCUpdateBlock(buffer, samples);
+  SoundCortexTraceRender(applied);
+#if defined(BUILD_METER)
+  // Voices are sampled in the state at the end of the block.
+  for (uint32_t i = 0; i < samples; ++i)
+    SoundCortexMeter(buffer[i], true);
+#endif
+#else
+  for (uint32_t i = 0; i < samples; ++i) {
+    buffer[i] = SoundCortexMix();
+    if (i == 0)
+      SoundCortexTraceRender(applied);
+#if defined(BUILD_METER)
+    SoundCortexMeter(buffer[i], true);
+#endif
+  }
+#endif
+}
+
+void SoundCortexUpdateBlock(uint16_t* buffer, uint32_t samples) {
+#if defined(BUILD_LOOP_CACHE)
+  // Loop points are tracked per sample while the cache is enabled.
+  if (cache.capacity) {
+    for (uint32_t i = 0; i < samples; ++i)
+      buffer[i] = SoundCortexUpdate();
+    return;
+  }
+#endif
+  if (!samples)
+    return;
+#if defined(BUILD_MIDI)
+  MIDIUpdate(21, true, 120);
+#endif
+  for (uint32_t start = 0; start < samples;) {
+    uint8_t applied = SoundCortexFlush();
+    // The block is split where MIDI playback changes registers, so that
+    // events sound at their own samples as SoundCortexUpdate() plays them.
+    uint32_t end = start + 1;
+#if defined(BUILD_MIDI)
+    for (; end < samples; ++end) {
+      MIDIUpdate(21, true, 120);
+      if (SoundCortexIsDirty())
+        break;
+    }
+#else
+    end = samples;
+#endif
+    SoundCortexRender(&buffer[start], end - start, applied);
+    start = end;
+  }
+}
+
 #if defined(BUILD_I2C)
 // I2C Slave handling code.
 static uint8_t i2c_addr = 0;
@@ -63,6 +558,7 @@ bool I2CSlaveWrite(uint8_t data) {
   if (i2c_data_index == 0) {
     i2c_data_addr = data;
   } else if (i2c_data_index == 1) {
+    SoundCortexBusWrite(i2c_addr, i2c_data_addr, data);
 #  if defined(BUILD_PSG) && !defined(BUILD_SCC)
     return PSGWrite(i2c_data_addr, data);
 #  elif !defined(BUILD_PSG) && defined(BUILD_SCC)
@@ -100,16 +596,19 @@ bool I2CSlaveRead(uint8_t* data) {
 static uint8_t spi_chip_select = PSG_ADDRESS;
 
 void SPISlaveWrite16(uint16_t data) {
-  if ((data >> 8) == 0xff)
+  if ((data >> 8) == 0xff) {
     spi_chip_select = data;
+  } else {
+    SoundCortexBusWrite(spi_chip_select, data >> 8, data);
 #if defined(BUILD_PSG)
-  else if (spi_chip_select == PSG_ADDRESS)
-    PSGWrite(data >> 8, data);
+    if (spi_chip_select == PSG_ADDRESS)
+      PSGWrite(data >> 8, data);
 #endif
 #if defined(BUILD_SCC)
-  else if (spi_chip_select == SCC_ADDRESS)
-    SCCWrite(data >> 8, data);
+    if (spi_chip_select == SCC_ADDRESS)
+      SCCWrite(data >> 8, data);
 #endif
+  }
 }
 #endif
 
@@ -142,6 +641,7 @@ bool IOEXTSlaveWrite(uint8_t port, uint8_t data) {
     psg_address = data;
     break;
   case PSG_DATA_PORT:
+    SoundCortexBusWrite(PSG_ADDRESS, psg_address, data);
     PSGWrite(psg_address, data);
     break;
 #endif
@@ -150,6 +650,7 @@ bool IOEXTSlaveWrite(uint8_t port, uint8_t data) {
     scc_address = data;
     break;
   case SCC_DATA_PORT:
+    SoundCortexBusWrite(SCC_ADDRESS, scc_address, data);
     SCCWrite(scc_address, data);
     break;
 #endif
@@ -209,7 +710,140 @@ void SoundCortexInit(uint32_t sample_rate) {
   SlaveInit(PSG_ADDRESS, SCC_ADDRESS);
 #else
 #endif
-#if defined(BUILD_MIDI)
+#if defined(SOUNDCORTEX_SMF)
   MIDIInit(SMF);
 #endif
+#if defined(BUILD_LOOP_CACHE)
+  cache.mode = CACHE_OFF;
+  cache.pending = 0;
+#endif
+#if defined(BUILD_ADAPTIVE_BLOCK)
+  block.seen = block.writes;
+  block.size = BLOCK_MAX;
+  block.quiet = 0;
+  SoundCortexBlockStats empty = { 0 };
+  block.stats = empty;
+#endif
+}
+
+uint32_t SoundCortexStateSize() {
+  uint32_t size = 0;
+#if defined(BUILD_PSG)
+  size += PSGStateSize();
+#endif
+#if defined(BUILD_SCC)
+  size += SCCStateSize();
+#endif
+#if defined(BUILD_MIDI)
+  size += MIDIStateSize();
+#endif
+  return size;
+}
+
+void SoundCortexSave(uint8_t* state) {
+#if defined(BUILD_LOOP_CACHE)
+  // Voices lag behind while the cache plays.
+  SoundCortexCatchUp();
+#endif
+#if defined(BUILD_PSG)
+  PSGSave(state);
+  state += PSGStateSize();
+#endif
+#if defined(BUILD_SCC)
+  SCCSave(state);
+  state += SCCStateSize();
+#endif
+#if defined(BUILD_MIDI)
+  MIDISave(state);
+#endif
+}
+
+void SoundCortexLoad(const uint8_t* state) {
+#if defined(BUILD_LOOP_CACHE)
+  // The cached pass no longer follows. Lagging voices are overwritten anyway.
+  cache.mode = CACHE_OFF;
+  cache.pending = 0;
+#endif
+#if defined(BUILD_PSG)
+  PSGLoad(state);
+  state += PSGStateSize();
+#endif
+#if defined(BUILD_SCC)
+  SCCLoad(state);
+  state += SCCStateSize();
+#endif
+#if defined(BUILD_MIDI)
+  MIDILoad(state);
+#endif
+}
+
+#if defined(BUILD_KEYFRAME) || defined(BUILD_RENDER_AHEAD)
+// Voices advance in bulk between register changes, so that the state matches
+// rendered one exactly at a fraction of the cost.
+void SoundCortexAdvance(uint32_t samples) {
+#if defined(BUILD_LOOP_CACHE)
+  // The song moves on without the cache.
+  SoundCortexLoopCacheStop();
+#endif
+  uint32_t pending = 0;
+  for (uint32_t i = 0; i < samples; ++i) {
+#if defined(BUILD_MIDI)
+    MIDIUpdate(21, true, 120);
+#endif
+#if defined(BUILD_LOOP_CACHE)
+    if (cache.capacity && cache.loops != MIDIGetLoops()) {
+      SoundCortexSkip(pending);
+      pending = 0;
+      SoundCortexLoopCacheLooped();
+    }
+#endif
+    if (SoundCortexIsDirty()) {
+      SoundCortexSkip(pending);
+      pending = 0;
+      SoundCortexFlush();
+    }
+    pending++;
+  }
+  SoundCortexSkip(pending);
 }
+#endif
+
+#if defined(BUILD_RENDER_AHEAD)
+bool SoundCortexWrite(uint8_t chip, uint8_t reg, uint8_t value) {
+#if defined(BUILD_LOOP_CACHE)
+  cache.written = 1;
+#endif
+#if defined(BUILD_PSG)
+  if (chip == PSG_ADDRESS)
+    return PSGWrite(reg, value);
+#endif
+#if defined(BUILD_SCC)
+  if (chip == SCC_ADDRESS)
+    return SCCWrite(reg, value);
+#endif
+  return false;
+}
+#endif
+
+#if defined(BUILD_KEYFRAME)
+void SoundCortexIndex(
+    uint8_t* keyframes, uint32_t count, uint32_t interval) {
+  uint32_t size = SoundCortexStateSize();
+  for (uint32_t i = 0; i < count; ++i) {
+    SoundCortexSave(&keyframes[i * size]);
+    SoundCortexAdvance(interval);
+  }
+}
+
+bool SoundCortexSeek(const uint8_t* keyframes, uint32_t count,
+                     uint32_t interval, uint32_t position) {
+  if (!count || !interval)
+    return false;
+  uint32_t index = position / interval;
+  if (index >= count)
+    return false;
+  SoundCortexLoad(&keyframes[index * SoundCortexStateSize()]);
+  SoundCortexAdvance(position - index * interval);
+  return true;
+}
+#endif
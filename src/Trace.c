@@ -0,0 +1,156 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+#include "Trace.h"
+
+#include <stdbool.h>
+
+#include "BuildConfig.h"
+
+#if defined(BUILD_TRACE)
+
+#if !defined(TRACE_SIZE)
+#  define TRACE_SIZE 32
+#endif
+
+typedef struct {
+  uint32_t time;
+  uint8_t event;
+  uint8_t chip;
+  uint8_t reg;
+  uint8_t value;
+} Entry;
+
+struct {
+  uint32_t head;
+  uint32_t count;
+  Entry entry[TRACE_SIZE];
+} TraceWork;
+
+_Static_assert(sizeof(TraceWork) == TRACE_SIZE * 8 + 8, "TraceWork");
+
+#define STR(x) #x
+#define XSTR(x) STR(x)
+#pragma message("TraceWork: " XSTR(TRACE_SIZE) " x 8 + 8 bytes")
+
+void TraceRecord(uint8_t event, uint8_t chip, uint8_t reg, uint8_t value) {
+  // Not atomic against bus interrupts. A colliding event may be lost, but the
+  // ring itself stays consistent.
+  uint32_t head = TraceWork.head;
+  TraceWork.head = (head + 1) % TRACE_SIZE;
+  if (TraceWork.count < TRACE_SIZE)
+    TraceWork.count++;
+  Entry* entry = &TraceWork.entry[head];
+  entry->time = TraceClock();
+  entry->event = event;
+  entry->chip = chip;
+  entry->reg = reg;
+  entry->value = value;
+}
+
+static const char* TraceNumber(uint32_t value) {
+  static char buffer[11];
+  char* p = &buffer[10];
+  *p = 0;
+  do {
+    *--p = '0' + value % 10;
+    value /= 10;
+  } while (value);
+  return p;
+}
+
+static void TraceEvent(void (*output)(const char* text), const char* name,
+                       const char* phase, const Entry* entry, uint32_t dur) {
+  output("{\"name\":\"");
+  output(name);
+  output("\",\"ph\":\"");
+  output(phase);
+  output("\",\"pid\":0,\"tid\":");
+  output(TraceNumber(entry->chip));
+  output(",\"ts\":");
+  output(TraceNumber(entry->time));
+  if (phase[0] == 'X') {
+    output(",\"dur\":");
+    output(TraceNumber(dur));
+  } else {
+    output(",\"s\":\"t\"");
+  }
+  output(",\"args\":{\"reg\":");
+  output(TraceNumber(entry->reg));
+  output(",\"value\":");
+  output(TraceNumber(entry->value));
+  output("}}");
+}
+
+void TraceDump(void (*output)(const char* text)) {
+  static const char* names[] = { "write", "apply", "render" };
+  // Per chip, indexed by address LSB, oldest write not applied yet, and
+  // oldest write applied but not rendered yet.
+  Entry written[2];
+  Entry applied[2];
+  bool has_written[2] = { false, false };
+  bool has_applied[2] = { false, false };
+  uint32_t count = TraceWork.count;
+  uint32_t index = (TraceWork.head + TRACE_SIZE - count) % TRACE_SIZE;
+  TraceWork.count = 0;
+
+  output("{\"traceEvents\":[");
+  for (uint32_t i = 0; i < count; ++i) {
+    Entry entry = TraceWork.entry[(index + i) % TRACE_SIZE];
+    uint8_t slot = entry.chip & 1;
+    if (i)
+      output(",");
+    TraceEvent(output, names[entry.event], "i", &entry, 0);
+    switch (entry.event) {
+    case TRACE_BUS_WRITE:
+      if (!has_written[slot])
+        written[slot] = entry;
+      has_written[slot] = true;
+      break;
+    case TRACE_APPLY:
+      if (has_written[slot] && !has_applied[slot]) {
+        applied[slot] = written[slot];
+        has_applied[slot] = true;
+        has_written[slot] = false;
+      }
+      break;
+    case TRACE_RENDER:
+      if (has_applied[slot]) {
+        output(",");
+        TraceEvent(output, "latency", "X", &applied[slot],
+                   entry.time - applied[slot].time);
+        has_applied[slot] = false;
+      }
+      break;
+    }
+  }
+  output("]}\n");
+}
+
+#endif  // defined(BUILD_TRACE)
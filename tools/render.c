@@ -0,0 +1,176 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Renders a song offline on several threads, and writes samples that
+// SoundCortexUpdate() returns as unsigned 16-bit little endian raw PCM.
+// Emulators should be built for the host with a BuildConfig.h that defines
+// BUILD_HOST, BUILD_KEYFRAME, BUILD_MIDI, BUILD_PSG, and optionally
+// BUILD_SCC. It needs no SMF.h, as songs are given here.
+//
+//   $ cc -O2 -pthread -I<config> -Iinc -Isrc -o render tools/render.c
+//       src/SoundCortex.c src/PSG.c src/SCC.c src/MIDI.c
+//   $ ./render song.mid 600 8 song.raw
+//
+// The first pass runs only the sequencer and register state, and takes a
+// snapshot at each segment boundary. Then each thread restores one snapshot
+// and renders its segment. The result is identical to the serial rendering.
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "BuildConfig.h"
+#include "SoundCortex.h"
+
+enum {
+  SAMPLE_RATE = 48000,
+  MAX_THREADS = 64,
+};
+
+typedef struct {
+  pthread_t thread;
+  uint32_t start;
+  uint32_t samples;
+  uint16_t* buffer;
+  uint32_t misses;
+} Segment;
+
+static uint8_t* song;
+static uint8_t* keyframes;
+static uint32_t interval;
+static uint32_t count;
+
+static double Now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void* Render(void* arg) {
+  Segment* segment = arg;
+  // Work areas are per thread, and tables are built on initialization.
+  SoundCortexInit(SAMPLE_RATE);
+  MIDIInit(song);
+  SoundCortexSeek(keyframes, count, interval, segment->start);
+  for (uint32_t i = 0; i < segment->samples; ++i)
+    segment->buffer[i] = SoundCortexUpdate();
+#if defined(BUILD_SCC_INTERN)
+  // Shared wave tables outlive the thread.
+  segment->misses = SCCGetWaveMisses();
+  SCCRelease();
+#endif
+  return NULL;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 5) {
+    fprintf(stderr, "usage: %s <song> <seconds> <threads> <output.raw>\n",
+            argv[0]);
+    return 1;
+  }
+  uint32_t samples = atoi(argv[2]) * SAMPLE_RATE;
+  count = atoi(argv[3]);
+  if (!samples || !count || count > MAX_THREADS) {
+    fprintf(stderr, "invalid length or threads\n");
+    return 1;
+  }
+  FILE* fp = fopen(argv[1], "rb");
+  if (!fp) {
+    perror(argv[1]);
+    return 1;
+  }
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  song = malloc(size);
+  if (!song || fread(song, 1, size, fp) != (size_t)size) {
+    perror(argv[1]);
+    return 1;
+  }
+  fclose(fp);
+
+  SoundCortexInit(SAMPLE_RATE);
+  if (!MIDIInit(song)) {
+    fprintf(stderr, "%s: unsupported song\n", argv[1]);
+    return 1;
+  }
+  double start = Now();
+  interval = (samples + count - 1) / count;
+  keyframes = malloc(count * SoundCortexStateSize());
+  uint16_t* pcm = malloc(samples * sizeof(uint16_t));
+  if (!keyframes || !pcm) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  SoundCortexIndex(keyframes, count, interval);
+  double scanned = Now();
+
+  Segment segments[MAX_THREADS];
+  // Segments that would start at or after the end are not rendered.
+  uint32_t threads = 0;
+  for (uint32_t i = 0; i < count && i * interval < samples; ++i) {
+    segments[i].start = i * interval;
+    segments[i].samples = samples - segments[i].start;
+    if (segments[i].samples > interval)
+      segments[i].samples = interval;
+    segments[i].buffer = &pcm[segments[i].start];
+    segments[i].misses = 0;
+    if (pthread_create(&segments[i].thread, NULL, Render, &segments[i])) {
+      fprintf(stderr, "failed to start a thread\n");
+      return 1;
+    }
+    threads++;
+  }
+  uint32_t misses = 0;
+  for (uint32_t i = 0; i < threads; ++i) {
+    pthread_join(segments[i].thread, NULL);
+    misses += segments[i].misses;
+  }
+  double rendered = Now();
+  if (misses) {
+    fprintf(stderr, "%u SCC wave tables did not get a slot\n", misses);
+    return 1;
+  }
+
+  fp = fopen(argv[4], "wb");
+  if (!fp) {
+    perror(argv[4]);
+    return 1;
+  }
+  for (uint32_t i = 0; i < samples; ++i) {
+    fputc(pcm[i] & 0xff, fp);
+    fputc(pcm[i] >> 8, fp);
+  }
+  fclose(fp);
+  printf("%u samples, scan %.2fs, render %.2fs on %u threads\n",
+         samples, scanned - start, rendered - scanned, threads);
+  return 0;
+}
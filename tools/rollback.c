@@ -0,0 +1,191 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Checks BUILD_RENDER_AHEAD against a serial rendering. Random register
+// writes are rendered once at their exact samples, and once through
+// RenderAheadWrite() arriving up to JITTER samples early, with reads and
+// fills interleaved at random so that rollbacks land before and after the
+// playback cursor. Emulators should be built for the host with a
+// BuildConfig.h that defines BUILD_HOST, BUILD_MIDI, BUILD_PSG, BUILD_SCC,
+// and BUILD_RENDER_AHEAD. It needs no SMF.h, as songs are given here.
+//
+//   $ cc -O2 -I<config> -Iinc -Isrc -o rollback tools/rollback.c
+//       src/SoundCortex.c src/RenderAhead.c src/PSG.c src/SCC.c src/MIDI.c
+//   $ ./rollback song.mid 60
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "BuildConfig.h"
+#include "SoundCortex.h"
+
+enum {
+  SAMPLE_RATE = 48000,
+  CAPACITY = 4096,
+  COUNT = 6,
+  INTERVAL = 1024,
+  JITTER = 3000,
+  SPACING = 480,  // average samples between writes
+};
+
+typedef struct {
+  uint32_t time;
+  uint32_t arrive;
+  uint8_t chip;
+  uint8_t reg;
+  uint8_t value;
+} Write;
+
+static int CompareArrival(const void* a, const void* b) {
+  const Write* x = *(const Write* const*)a;
+  const Write* y = *(const Write* const*)b;
+  if (x->arrive != y->arrive)
+    return x->arrive < y->arrive ? -1 : 1;
+  return x < y ? -1 : x > y;
+}
+
+static void Apply(const Write* write) {
+  if (write->chip == PSG_ADDRESS)
+    PSGWrite(write->reg, write->value);
+  else
+    SCCWrite(write->reg, write->value);
+}
+
+static uint8_t* Load(const char* name) {
+  FILE* fp = fopen(name, "rb");
+  if (!fp)
+    return NULL;
+  fseek(fp, 0, SEEK_END);
+  long size = ftell(fp);
+  fseek(fp, 0, SEEK_SET);
+  uint8_t* data = malloc(size);
+  if (data && fread(data, 1, size, fp) != (size_t)size) {
+    free(data);
+    data = NULL;
+  }
+  fclose(fp);
+  return data;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <song> <seconds>\n", argv[0]);
+    return 1;
+  }
+  uint32_t samples = atoi(argv[2]) * SAMPLE_RATE;
+  uint8_t* song = Load(argv[1]);
+  if (!song) {
+    perror(argv[1]);
+    return 1;
+  }
+  SoundCortexInit(SAMPLE_RATE);
+  if (!MIDIInit(song)) {
+    fprintf(stderr, "%s: unsupported song\n", argv[1]);
+    return 1;
+  }
+
+  // Times are distinct, as writes at the same time are ordered by arrival.
+  srand(1);
+  uint32_t writes = samples / SPACING;
+  Write* write = malloc(writes * sizeof(Write));
+  Write** order = malloc(writes * sizeof(Write*));
+  uint16_t* expected = malloc(samples * sizeof(uint16_t));
+  uint16_t* actual = malloc(samples * sizeof(uint16_t));
+  uint8_t* initial = malloc(SoundCortexStateSize());
+  uint8_t* snapshots = malloc(COUNT * SoundCortexStateSize());
+  uint16_t* buffer = malloc(CAPACITY * sizeof(uint16_t));
+  if (!write || !order || !expected || !actual || !initial || !snapshots ||
+      !buffer) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+  uint32_t time = 0;
+  for (uint32_t i = 0; i < writes; ++i) {
+    time += 1 + rand() % (SPACING * 2);
+    uint32_t jitter = rand() % JITTER;
+    write[i].time = time;
+    write[i].arrive = time > jitter ? time - jitter : 0;
+    write[i].chip = (rand() & 1) ? PSG_ADDRESS : SCC_ADDRESS;
+    if (write[i].chip == PSG_ADDRESS)
+      write[i].reg = rand() % 0x0b;
+    else
+      write[i].reg = rand() % 0xb0;
+    write[i].value = rand();
+    order[i] = &write[i];
+  }
+  qsort(order, writes, sizeof(Write*), CompareArrival);
+
+  SoundCortexSave(initial);
+  for (uint32_t pos = 0, i = 0; pos < samples; ++pos) {
+    for (; i < writes && write[i].time == pos; ++i)
+      Apply(&write[i]);
+    expected[pos] = SoundCortexUpdate();
+  }
+
+  SoundCortexLoad(initial);
+  RenderAheadInit(buffer, CAPACITY, snapshots, COUNT, INTERVAL);
+  uint32_t cursor = 0;
+  uint32_t next = 0;
+  while (cursor < samples) {
+    for (; next < writes && order[next]->arrive <= cursor; ++next) {
+      RenderAheadWrite(order[next]->time, order[next]->chip, order[next]->reg,
+                       order[next]->value);
+    }
+    if (rand() & 1)
+      RenderAheadFill();
+    // Reads stop at the next arrival so that no write comes late.
+    uint32_t request = 1 + rand() % 512;
+    if (request > samples - cursor)
+      request = samples - cursor;
+    if (next < writes && order[next]->arrive - cursor < request)
+      request = order[next]->arrive - cursor;
+    uint32_t read = RenderAheadRead(&actual[cursor], request);
+    if (!read)
+      RenderAheadFill();
+    cursor += read;
+  }
+
+  RenderAheadStats stats;
+  RenderAheadGetStats(&stats);
+  printf("%u writes, %u rollbacks, %u rerendered, %u late, %u dropped\n",
+         stats.writes, stats.rollbacks, stats.rerendered, stats.late,
+         stats.dropped);
+  for (uint32_t i = 0; i < samples; ++i) {
+    if (expected[i] != actual[i]) {
+      printf("mismatch at sample %u: %u != %u\n", i, actual[i], expected[i]);
+      return 1;
+    }
+  }
+  if (stats.late || stats.dropped) {
+    printf("writes did not arrive in time\n");
+    return 1;
+  }
+  printf("%u samples match the serial rendering\n", samples);
+  return 0;
+}
@@ -0,0 +1,354 @@
+// Copyright 2026, Takashi Toyoshima <toyoshim@gmail.com>
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//    * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//    * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//    * Neither the name of the authors nor the names of its contributors
+// may be used to endorse or promote products derived from this software
+// without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+//
+
+// Packs a format 0 SMF into a compressed song container that MIDI.c can play
+// with BUILD_MIDI_LZ, and writes it as a SMF.h header.
+//
+//   $ cc -O2 -o smfpack tools/smfpack.c
+//   $ ./smfpack song.mid SMF.h
+//
+// Events that the player ignores, i.e. system exclusive and meta events other
+// than end of track and tempo, are removed, and running status is applied
+// before compression. The report shows the compression ratio and the worst
+// case cost to decode one event, estimated with per operation cycle counts
+// on Cortex-M0.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Estimated Cortex-M0 cycles for each step of MIDIDecode().
+enum {
+  CYCLES_CALL = 10,
+  CYCLES_FLAGS = 6,
+  CYCLES_LITERAL = 12,
+  CYCLES_MATCH = 10,
+  CYCLES_COPY = 14,
+};
+
+enum {
+  WINDOW = 256,
+  MIN_MATCH = 3,
+  MAX_MATCH = 255,
+};
+
+typedef struct {
+  uint8_t* data;
+  uint32_t size;
+  uint32_t capacity;
+} Buffer;
+
+static void Put(Buffer* buffer, uint8_t data) {
+  if (buffer->size == buffer->capacity) {
+    buffer->capacity = buffer->capacity ? buffer->capacity * 2 : 1024;
+    buffer->data = realloc(buffer->data, buffer->capacity);
+    if (!buffer->data) {
+      fprintf(stderr, "out of memory\n");
+      exit(1);
+    }
+  }
+  buffer->data[buffer->size++] = data;
+}
+
+static void PutVarLen(Buffer* buffer, uint32_t value) {
+  uint8_t bytes[5];
+  int n = 0;
+  do {
+    bytes[n++] = value & 0x7f;
+    value >>= 7;
+  } while (value);
+  while (n--)
+    Put(buffer, bytes[n] | (n ? 0x80 : 0));
+}
+
+static uint32_t GetVarLen(const uint8_t** p, const uint8_t* end) {
+  uint32_t value = 0;
+  uint8_t data;
+  do {
+    if (*p >= end)
+      return value;
+    data = *(*p)++;
+    value = (value << 7) | (data & 0x7f);
+  } while (data & 0x80);
+  return value;
+}
+
+static uint32_t Get32(const uint8_t* p) {
+  return ((uint32_t)p[0] << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static void PutOffset(Buffer* buffer, uint32_t offset) {
+  for (int i = 0; i < 4; ++i)
+    Put(buffer, offset >> (i * 8));
+}
+
+static uint32_t GetOffset(const Buffer* buffer, uint32_t index) {
+  const uint8_t* p = &buffer->data[index * 4];
+  return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// Rewrites the track with only events the player uses. |events| receives
+// the offset of each event, and the track size at the end.
+static bool Strip(const uint8_t* p, const uint8_t* end, Buffer* track,
+                  Buffer* events) {
+  uint32_t delta = 0;
+  uint8_t status = 0;
+  uint8_t last_status = 0;
+  while (p < end) {
+    delta += GetVarLen(&p, end);
+    if (p >= end)
+      return false;
+    uint8_t data1 = *p;
+    if (data1 & 0x80) {
+      status = *p++;
+      data1 = 0;
+    } else if (!status || status >= 0xf0) {
+      fprintf(stderr, "data byte without status\n");
+      return false;
+    }
+    uint32_t start = track->size;
+    if (status < 0xf0) {
+      int size = (status & 0xe0) == 0xc0 ? 1 : 2;
+      if (p + size > end)
+        return false;
+      PutVarLen(track, delta);
+      if (status != last_status)
+        Put(track, status);
+      for (int i = 0; i < size; ++i)
+        Put(track, *p++);
+      last_status = status;
+    } else if (status == 0xf0 || status == 0xf7) {
+      uint32_t size = GetVarLen(&p, end);
+      p += size;
+      status = 0;
+      continue;
+    } else if (status == 0xff) {
+      if (p >= end)
+        return false;
+      uint8_t type = *p++;
+      uint32_t size = GetVarLen(&p, end);
+      if (type != 0x2f && type != 0x51) {
+        p += size;
+        status = 0;
+        continue;
+      }
+      PutVarLen(track, delta);
+      Put(track, 0xff);
+      Put(track, type);
+      PutVarLen(track, size);
+      for (uint32_t i = 0; i < size && p < end; ++i)
+        Put(track, *p++);
+      status = 0;
+      last_status = 0;
+      if (type == 0x2f) {
+        PutOffset(events, start);
+        break;
+      }
+    } else {
+      fprintf(stderr, "unsupported status $%02x\n", status);
+      return false;
+    }
+    delta = 0;
+    PutOffset(events, start);
+  }
+  if (track->size < 4 ||
+      memcmp(&track->data[track->size - 3], "\xff\x2f\x00", 3) != 0) {
+    fprintf(stderr, "no end of track\n");
+    return false;
+  }
+  PutOffset(events, track->size);
+  return true;
+}
+
+// Greedy LZSS with the format MIDIDecode() expects.
+static void Compress(const Buffer* track, Buffer* out) {
+  uint32_t i = 0;
+  while (i < track->size) {
+    uint32_t flags_at = out->size;
+    uint8_t flags = 0;
+    Put(out, 0);
+    for (int bit = 0; bit < 8 && i < track->size; ++bit) {
+      uint32_t best_length = 0;
+      uint32_t best_distance = 0;
+      for (uint32_t distance = 1; distance <= WINDOW && distance <= i;
+           ++distance) {
+        uint32_t length = 0;
+        while (length < MAX_MATCH && i + length < track->size &&
+               track->data[i + length] == track->data[i + length - distance])
+          length++;
+        if (length > best_length) {
+          best_length = length;
+          best_distance = distance;
+        }
+      }
+      if (best_length >= MIN_MATCH) {
+        Put(out, best_distance - 1);
+        Put(out, best_length);
+        i += best_length;
+      } else {
+        flags |= 1 << bit;
+        Put(out, track->data[i++]);
+      }
+    }
+    out->data[flags_at] = flags;
+  }
+}
+
+// Mirrors MIDIDecode(), and records estimated cycles to produce each byte.
+static bool Decode(const Buffer* packed, const Buffer* track,
+                   uint32_t* cycles) {
+  uint8_t window[WINDOW];
+  uint8_t pos = 0;
+  uint8_t flags = 0;
+  uint8_t bits = 0;
+  uint8_t length = 0;
+  uint8_t distance = 0;
+  const uint8_t* p = packed->data;
+  for (uint32_t i = 0; i < track->size; ++i) {
+    uint8_t data;
+    cycles[i] = CYCLES_CALL;
+    if (!length) {
+      if (!bits) {
+        flags = *p++;
+        bits = 8;
+        cycles[i] += CYCLES_FLAGS;
+      }
+      bits--;
+      bool literal = flags & 1;
+      flags >>= 1;
+      if (literal) {
+        data = *p++;
+        window[pos++] = data;
+        cycles[i] += CYCLES_LITERAL;
+        if (data != track->data[i])
+          return false;
+        continue;
+      }
+      distance = p[0];
+      length = p[1];
+      p += 2;
+      cycles[i] += CYCLES_MATCH;
+    }
+    length--;
+    data = window[(uint8_t)(pos - distance - 1)];
+    window[pos++] = data;
+    cycles[i] += CYCLES_COPY;
+    if (data != track->data[i])
+      return false;
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  if (argc != 3) {
+    fprintf(stderr, "usage: %s <input.mid> <SMF.h>\n", argv[0]);
+    return 1;
+  }
+  FILE* fp = fopen(argv[1], "rb");
+  if (!fp) {
+    perror(argv[1]);
+    return 1;
+  }
+  Buffer smf = { 0 };
+  int c;
+  while ((c = fgetc(fp)) != EOF)
+    Put(&smf, c);
+  fclose(fp);
+
+  const uint8_t* data = smf.data;
+  if (smf.size < 22 || memcmp(data, "MThd\0\0\0\6", 8) != 0 ||
+      memcmp(&data[14], "MTrk", 4) != 0 || data[10] != 0 || data[11] != 1) {
+    fprintf(stderr, "%s: not a single track SMF\n", argv[1]);
+    return 1;
+  }
+  uint32_t track_size = Get32(&data[18]);
+  if (22 + track_size > smf.size) {
+    fprintf(stderr, "%s: truncated track\n", argv[1]);
+    return 1;
+  }
+
+  Buffer track = { 0 };
+  Buffer events = { 0 };
+  if (!Strip(&data[22], &data[22 + track_size], &track, &events))
+    return 1;
+
+  Buffer packed = { 0 };
+  Compress(&track, &packed);
+
+  uint32_t* cycles = calloc(track.size, sizeof(uint32_t));
+  if (!cycles || !Decode(&packed, &track, cycles)) {
+    fprintf(stderr, "internal error: round trip mismatch\n");
+    return 1;
+  }
+  uint32_t worst_event = 0;
+  uint32_t worst_bytes = 0;
+  uint32_t event_count = events.size / 4 - 1;
+  for (uint32_t i = 0; i < event_count; ++i) {
+    uint32_t begin = GetOffset(&events, i);
+    uint32_t end = GetOffset(&events, i + 1);
+    uint32_t sum = 0;
+    for (uint32_t j = begin; j < end; ++j)
+      sum += cycles[j];
+    if (sum > worst_event) {
+      worst_event = sum;
+      worst_bytes = end - begin;
+    }
+  }
+
+  fp = fopen(argv[2], "w");
+  if (!fp) {
+    perror(argv[2]);
+    return 1;
+  }
+  uint32_t size = 10 + packed.size;
+  fprintf(fp, "// Generated by tools/smfpack.c from %s\n", argv[1]);
+  fprintf(fp, "#include <stdint.h>\n\n");
+  fprintf(fp, "const uint8_t SMF[%u] = {\n", size);
+  uint8_t header[10] = {
+    'S', 'C', 'Z', '1', data[12], data[13],
+    packed.size >> 24, packed.size >> 16, packed.size >> 8, packed.size,
+  };
+  for (uint32_t i = 0; i < size; ++i) {
+    uint8_t byte = i < 10 ? header[i] : packed.data[i - 10];
+    fprintf(fp, "%s0x%02x,%s", i % 12 ? " " : "  ", byte,
+            (i % 12 == 11 || i == size - 1) ? "\n" : "");
+  }
+  fprintf(fp, "};\n");
+  fclose(fp);
+
+  printf("input:  %u bytes (track %u bytes)\n", smf.size, track_size);
+  printf("strip:  %u bytes, %u events\n", track.size, event_count);
+  printf("packed: %u bytes, %.1f%% of input\n", size, 100.0 * size / smf.size);
+  printf("decode: worst %u cycles for a %u byte event, %u RAM window bytes\n",
+         worst_event, worst_bytes, WINDOW);
+  return 0;
+}